@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cassert>
+#include "include/EvictPathPool.h"
+using namespace std;
+
+EvictPathPool::EvictPathPool(size_t capacity, int p) {
+    configure(capacity, p);
+}
+
+void EvictPathPool::configure(size_t n, int p) {
+    assert(n > 0);
+    assert(p == random_path || p == most_recent || p == least_full);
+    capacity = n;
+    leaves.assign(2 * n, -1);
+    policy = p;
+    dropped_count = 0;
+    clear();
+}
+
+void EvictPathPool::clear() {
+    head = 0;
+    span = 0;
+    count = 0;
+}
+
+// trims tombstones off both ends and compacts once they outnumber the entries
+void EvictPathPool::settle() {
+    while (span > 0 && leaves[slot(0)] < 0) {
+        head = (head + 1) % leaves.size();
+        span--;
+    }
+    while (span > 0 && leaves[slot(span - 1)] < 0)
+        span--;
+    if (span - count <= count)
+        return;
+    size_t n = 0;
+    for (size_t pos = 0; pos < span; pos++)
+        if (leaves[slot(pos)] >= 0)
+            leaves[slot(n++)] = leaves[slot(pos)];
+    span = n;
+}
+
+void EvictPathPool::push(int64_t leaf) {
+    assert(leaf >= 0);
+    if (count == capacity) {
+        leaves[slot(0)] = -1;
+        count--;
+        dropped_count++;
+        settle();
+    }
+    leaves[slot(span)] = leaf;
+    span++;
+    count++;
+}
+
+int64_t EvictPathPool::at(size_t pos) {
+    assert(pos < span);
+    return leaves[slot(pos)];
+}
+
+int64_t EvictPathPool::removeAt(size_t pos) {
+    assert(pos < span && leaves[slot(pos)] >= 0);
+    int64_t leaf = leaves[slot(pos)];
+    leaves[slot(pos)] = -1;
+    count--;
+    settle();
+    return leaf;
+}
+
+void EvictPathPool::remove(int64_t leaf) {
+    for (size_t pos = 0; pos < span; pos++)
+        if (leaves[slot(pos)] == leaf) {
+            leaves[slot(pos)] = -1;
+            count--;
+        }
+    settle();
+}
+
+bool EvictPathPool::empty() { return count == 0; }
+size_t EvictPathPool::size() { return count; }
+size_t EvictPathPool::getSpan() { return span; }
+size_t EvictPathPool::getCapacity() { return capacity; }
+int EvictPathPool::getPolicy() { return policy; }
+int64_t EvictPathPool::getDroppedCount() { return dropped_count; }
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include "include/Histogram.h"
+using namespace std;
+
+Histogram::Histogram() {
+    counts.assign(bucket_count, 0);
+    reset();
+}
+
+int Histogram::indexOf(uint64_t value) {
+    if (value < (uint64_t)sub_bucket_count)
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - sub_bucket_bits + 1;
+    int mantissa = (int)(value >> shift);      // in [sub_bucket_half, sub_bucket_count)
+    return sub_bucket_count + (shift - 1) * sub_bucket_half + (mantissa - sub_bucket_half);
+}
+
+uint64_t Histogram::highestValueOf(int index) {
+    if (index < sub_bucket_count)
+        return index;
+    int shift = (index - sub_bucket_count) / sub_bucket_half + 1;
+    uint64_t mantissa = (index - sub_bucket_count) % sub_bucket_half + sub_bucket_half;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value, uint64_t n) {
+    counts[indexOf(value)] += n;
+    total_count += n;
+    sum += (double)value * n;
+    min_value = min(min_value, value);
+    max_value = max(max_value, value);
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (int i = 0; i < bucket_count; i++)
+        counts[i] += other.counts[i];
+    total_count += other.total_count;
+    sum += other.sum;
+    min_value = min(min_value, other.min_value);
+    max_value = max(max_value, other.max_value);
+}
+
+void Histogram::reset() {
+    fill(counts.begin(), counts.end(), 0);
+    total_count = 0;
+    min_value = UINT64_MAX;
+    max_value = 0;
+    sum = 0.0;
+}
+
+uint64_t Histogram::getCount() const { return total_count; }
+uint64_t Histogram::getMin() const { return total_count ? min_value : 0; }
+uint64_t Histogram::getMax() const { return max_value; }
+double Histogram::getMean() const { return total_count ? sum / total_count : 0.0; }
+
+uint64_t Histogram::percentile(double p) const {
+    if (total_count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * total_count);
+    rank = max(rank, (uint64_t)1);
+    uint64_t seen = 0;
+    for (int i = 0; i < bucket_count; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return min(highestValueOf(i), max_value);
+    }
+    return max_value;
+}
+
+void Histogram::report(ostream& os, const string& name) const {
+    os << name << ": count " << total_count << ", mean " << fixed << setprecision(2) << getMean()
+       << ", p50 " << percentile(50) << ", p99 " << percentile(99) << ", p99.9 " << percentile(99.9)
+       << ", max " << getMax() << endl;
+}
@@ -0,0 +1,215 @@
+#include <iostream>
+#include <cassert>
+#include "include/IntegrityTree.h"
+#include "include/TreeLayout.h"
+#include "include/Logger.h"
+using namespace std;
+
+static uint64_t splitMix64(uint64_t& state) {
+    uint64_t x = (state += 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// both halves of the 128-bit product, folded
+static inline uint64_t foldMultiply(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t x = (a ^ (b >> 32)) * 0x9e3779b97f4a7c15ull + b;
+    return x ^ (x >> 29);
+#endif
+}
+
+IntegrityTree::IntegrityTree() {
+    mode = off;
+    hash_bytes = 32;
+    hash_cycles = 80;
+    bucket_count = 0;
+    level_count = 0;
+    z = 0;
+    block_size = 64;
+    ids = NULL;
+    leaves = NULL;
+    data = NULL;
+    valid = NULL;
+    root = 0;
+    open_leaf = -1;
+    dirty = false;
+    resetCounters();
+}
+
+void IntegrityTree::setMode(int m, int bytes, int cycles) {
+    assert(m == off || m == verify || m == verify_and_model);
+    assert(bytes > 0 && cycles >= 0);
+    mode = m;
+    hash_bytes = bytes;
+    hash_cycles = cycles;
+}
+
+int IntegrityTree::getMode() { return mode; }
+bool IntegrityTree::isEnabled() { return mode != off; }
+bool IntegrityTree::isModeled() { return mode == verify_and_model; }
+int IntegrityTree::getHashCycles() { return hash_cycles; }
+
+uint64_t IntegrityTree::pathCyclesBound(int read_cycles, int write_cycles) {
+    if (!isModeled())
+        return 0;
+    int64_t lines = hashLines(level_count - 1);
+    return (1ll * level_count * z + lines) * read_cycles + lines * write_cycles + 2ll * level_count * hash_cycles;
+}
+
+void IntegrityTree::attach(int64_t buckets, int levels, int slots_per_bucket, int bl_s,
+                           const int64_t* slot_ids, const int32_t* slot_leaves, const int64_t* payloads, const uint64_t* bucket_valid, unsigned seed) {
+    assert(slots_per_bucket <= 64);
+    bucket_count = buckets;
+    level_count = levels;
+    z = slots_per_bucket;
+    block_size = bl_s;
+    ids = slot_ids;
+    leaves = slot_leaves;
+    data = payloads;
+    valid = bucket_valid;
+
+    uint64_t state = seed;
+    nh_key.resize(4 * z);
+    for (size_t i = 0; i < nh_key.size(); i++)
+        nh_key[i] = (uint32_t)splitMix64(state);
+    for (int i = 0; i < 3; i++)
+        fold_key[i] = splitMix64(state) | 1;
+    message.assign(4 * z * level_count, 0);
+    path_hash.assign(level_count, 0);
+    node_hash.assign(bucket_count, 0);
+    rebuild();
+}
+
+void IntegrityTree::rebuild() {
+    for (int64_t b = bucket_count - 1; b >= 0; b--) {		// children before parents
+        loadBucket(b, message.data());
+        uint64_t left = 2 * b + 1 < bucket_count ? node_hash[2 * b + 1] : 0;
+        uint64_t right = 2 * b + 2 < bucket_count ? node_hash[2 * b + 2] : 0;
+        node_hash[b] = bucketHash(b, nhDigest(message.data(), nh_key.data(), 4 * z), left, right);
+    }
+    root = node_hash[0];
+    open_leaf = -1;
+    dirty = false;
+}
+
+uint64_t IntegrityTree::bucketHash(int64_t bucket, uint64_t digest, uint64_t left, uint64_t right) {
+    uint64_t h = foldMultiply(digest ^ fold_key[0], (uint64_t)bucket ^ fold_key[1]);
+    h = foldMultiply(h ^ valid[bucket], left ^ fold_key[2]);
+    return foldMultiply(h ^ fold_key[0], right ^ fold_key[1]);
+}
+
+// id, leaf and payload of every slot; empty slots hash as zeros whatever they still hold
+void IntegrityTree::loadBucket(int64_t bucket, uint32_t* words) {
+    uint64_t v = valid[bucket];
+    for (int j = 0; j < z; j++) {
+        int64_t slot = bucket * z + j;
+        uint32_t m = -(uint32_t)((v >> j) & 1);
+        words[4 * j] = (uint32_t)ids[slot] & m;
+        words[4 * j + 1] = (uint32_t)leaves[slot] & m;
+        words[4 * j + 2] = (uint32_t)data[slot] & m;
+        words[4 * j + 3] = (uint32_t)((uint64_t)data[slot] >> 32) & m;
+    }
+}
+
+// node hash of the root recomputed along the path to leaf from the buckets and the siblings' stored hashes
+uint64_t IntegrityTree::hashPath(int64_t leaf, bool store) {
+    int words = 4 * z;
+    int64_t b = leaf;
+    for (int level = level_count - 1; level >= 0; level--) {		// slot digests of the whole path first
+        loadBucket(b, &message[level * words]);
+        path_hash[level] = nhDigest(&message[level * words], nh_key.data(), words);
+        b = (b - 1) / 2;
+    }
+    uint64_t h = 0;
+    int64_t child = -1;
+    b = leaf;
+    for (int level = level_count - 1; level >= 0; level--) {
+        uint64_t left = 0, right = 0;
+        if (child >= 0) {
+            left = child == 2 * b + 1 ? h : node_hash[2 * b + 1];
+            right = child == 2 * b + 2 ? h : node_hash[2 * b + 2];
+        }
+        h = bucketHash(b, path_hash[level], left, right);
+        if (store)
+            node_hash[b] = h;
+        child = b;
+        b = (b - 1) / 2;
+    }
+    return h;
+}
+
+int64_t IntegrityTree::hashLines(int64_t hashes) {
+    return (hashes * hash_bytes + block_size - 1) / block_size;
+}
+
+int64_t IntegrityTree::getOpenPath() { return open_leaf; }
+
+IntegrityTree::Cost IntegrityTree::open(int64_t leaf, bool content_read) {
+    Cost c = { 0, 0 };
+    if (mode == off)
+        return c;
+    assert(open_leaf == -1);
+    if (!content_read) {		// the blocks on the path are needed to recompute its hashes
+        int64_t b = leaf;
+        for (int level = level_count - 1; level >= 0; level--) {
+            c.lines += popCount(valid[b]);
+            b = (b - 1) / 2;
+        }
+        content_lines_read += c.lines;
+    }
+    if (hashPath(leaf, false) != root) {
+        failure_count++;
+        ORAM_WARN("Integrity check failed on the path to leaf " << leaf);
+    }
+    verify_count++;
+    int64_t lines = hashLines(level_count - 1);
+    hash_lines_read += lines;
+    hash_count += level_count;
+    c.lines += lines;
+    c.hashes = level_count;
+    open_leaf = leaf;
+    dirty = false;
+    return c;
+}
+
+void IntegrityTree::markDirty() { dirty = true; }
+
+IntegrityTree::Cost IntegrityTree::close() {
+    Cost c = { 0, 0 };
+    if (open_leaf == -1)
+        return c;
+    if (dirty) {
+        root = hashPath(open_leaf, true);
+        update_count++;
+        c.lines = hashLines(level_count - 1);
+        c.hashes = level_count;
+        hash_lines_written += c.lines;
+        hash_count += level_count;
+    }
+    open_leaf = -1;
+    dirty = false;
+    return c;
+}
+
+void IntegrityTree::resetCounters() {
+    verify_count = 0;
+    update_count = 0;
+    failure_count = 0;
+    hash_count = 0;
+    hash_lines_read = 0;
+    hash_lines_written = 0;
+    content_lines_read = 0;
+}
+
+int64_t IntegrityTree::getVerifyCount() { return verify_count; }
+int64_t IntegrityTree::getUpdateCount() { return update_count; }
+int64_t IntegrityTree::getFailureCount() { return failure_count; }
+int64_t IntegrityTree::getHashCount() { return hash_count; }
+int64_t IntegrityTree::getHashLinesRead() { return hash_lines_read; }
+int64_t IntegrityTree::getHashLinesWritten() { return hash_lines_written; }
+int64_t IntegrityTree::getContentLinesRead() { return content_lines_read; }
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include "include/LastLevelCache.h"
+using namespace std;
+
+LastLevelCache::LastLevelCache() {
+    set_count = 0;
+    associativity = 0;
+    clock = 0;
+    resetMetric();
+}
+
+void LastLevelCache::configParameters(uint64_t cache_size, int line_size, int ways) {
+    assert(line_size > 0 && ways > 0);
+    int64_t sets = cache_size / line_size / ways;
+    assert(sets > 0);
+    set_count = 1;
+    while (set_count * 2 <= sets)
+        set_count *= 2;
+    associativity = ways;
+    Line invalid = { -1, false, 0 };
+    lines.assign(set_count * associativity, invalid);
+    clock = 0;
+    ORAM_INFO("LLC: " << set_count * associativity * line_size / 1024 << " KB, " << set_count << " sets x " << associativity << " ways.");
+}
+
+LastLevelCache::Result LastLevelCache::access(int64_t id, bool isWrite) {
+    assert(set_count > 0 && id >= 0);
+    Line* set = &lines[(id & (set_count - 1)) * associativity];
+    Result r = { false, -1, false };
+    clock++;
+
+    Line* victim = set;
+    for (int w = 0; w < associativity; w++) {
+        if (set[w].id == id) {
+            set[w].dirty |= isWrite;
+            set[w].last_use = clock;
+            hit_count++;
+            r.hit = true;
+            return r;
+        }
+        if (set[w].id < 0 || (victim->id >= 0 && set[w].last_use < victim->last_use))
+            victim = &set[w];
+    }
+
+    miss_count++;
+    if (victim->id >= 0) {
+        r.victim = victim->id;
+        r.victim_dirty = victim->dirty;
+        if (victim->dirty)
+            dirty_eviction_count++;
+        else
+            clean_eviction_count++;
+    }
+    victim->id = id;
+    victim->dirty = isWrite;
+    victim->last_use = clock;
+    return r;
+}
+
+int64_t LastLevelCache::getSetCount() { return set_count; }
+int LastLevelCache::getAssociativity() { return associativity; }
+int64_t LastLevelCache::getHitCount() { return hit_count; }
+int64_t LastLevelCache::getMissCount() { return miss_count; }
+int64_t LastLevelCache::getCleanEvictionCount() { return clean_eviction_count; }
+int64_t LastLevelCache::getDirtyEvictionCount() { return dirty_eviction_count; }
+
+double LastLevelCache::getHitRate() {
+    int64_t total = hit_count + miss_count;
+    return total ? hit_count * 1.0 / total : 0.0;
+}
+
+void LastLevelCache::resetMetric() {
+    hit_count = 0;
+    miss_count = 0;
+    clean_eviction_count = 0;
+    dirty_eviction_count = 0;
+}
+
+void LastLevelCache::report(ostream& os) {
+    os << "LLC: " << hit_count << " hits, " << miss_count << " misses (hit rate " << fixed << setprecision(2)
+       << getHitRate() * 100 << "%), " << clean_eviction_count << " clean / " << dirty_eviction_count << " dirty evictions" << endl;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include "include/Logger.h"
+using namespace std;
+
+atomic<int> Logger::runtime_level(ORAM_LOG_LEVEL);
+atomic<int> Logger::sink(Logger::console);
+TraceRing Logger::trace_ring;
+
+TraceRing::TraceRing() {
+    entries = NULL;
+    capacity = 0;
+    head = 0;
+    dropped = 0;
+    setCapacity(1 << 16);
+}
+
+TraceRing::~TraceRing() {
+    delete[] entries;
+}
+
+void TraceRing::setCapacity(uint64_t cap) {
+    uint64_t c = 1;
+    while (c < cap)
+        c <<= 1;
+    delete[] entries;
+    entries = new Entry[c];
+    capacity = c;
+    clear();
+}
+
+void TraceRing::clear() {
+    for (uint64_t i = 0; i < capacity; i++)
+        entries[i].seq.store(0, memory_order_relaxed);
+    head.store(0, memory_order_release);
+    dropped.store(0, memory_order_relaxed);
+}
+
+void TraceRing::push(int level, const string& msg) {
+    uint64_t pos = head.fetch_add(1, memory_order_relaxed);
+    Entry& e = entries[pos & (capacity - 1)];
+
+    uint64_t s = e.seq.load(memory_order_relaxed);
+    do {
+        if ((s & 1) || s / 2 > pos) {       // being written, or already holding a newer entry
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    } while (!e.seq.compare_exchange_weak(s, 2 * pos + 1, memory_order_acquire, memory_order_relaxed));		// after the previous entry's writer
+    atomic_thread_fence(memory_order_release);
+    e.timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    e.thread = (uint32_t)hash<thread::id>()(this_thread::get_id());
+    e.level = (uint8_t)level;
+    size_t len = min(msg.size(), (size_t)message_size - 1);
+    memcpy(e.message, msg.data(), len);
+    e.message[len] = '\0';
+    e.seq.store(2 * (pos + 1), memory_order_release);
+}
+
+void TraceRing::drain(ostream& os) {
+    uint64_t h = head.load(memory_order_acquire);
+    uint64_t start = (h > capacity) ? h - capacity : 0;
+    Entry copy;
+    for (uint64_t pos = start; pos < h; pos++) {
+        Entry& e = entries[pos & (capacity - 1)];
+        uint64_t s1 = e.seq.load(memory_order_acquire);
+        if (s1 != 2 * (pos + 1))
+            continue;       // not finished yet or already overwritten
+        copy.timestamp = e.timestamp;
+        copy.thread = e.thread;
+        copy.level = e.level;
+        memcpy(copy.message, e.message, message_size);
+        atomic_thread_fence(memory_order_acquire);
+        if (e.seq.load(memory_order_relaxed) != s1)
+            continue;
+        copy.message[message_size - 1] = '\0';
+        os << copy.timestamp << " [" << Logger::levelName(copy.level) << "] <" << copy.thread << "> " << copy.message << "\n";
+    }
+    os.flush();
+}
+
+uint64_t TraceRing::getCapacity() { return capacity; }
+uint64_t TraceRing::getPushedCount() { return head.load(memory_order_relaxed); }
+uint64_t TraceRing::getDroppedCount() { return dropped.load(memory_order_relaxed); }
+
+
+void Logger::write(int level, const string& msg) {
+    if (sink.load(memory_order_relaxed) == ring)
+        trace_ring.push(level, msg);
+    else
+        cout << msg << endl;
+}
+
+void Logger::setLevel(int level) { runtime_level.store(level, memory_order_relaxed); }
+void Logger::setSink(Sink s) { sink.store(s, memory_order_relaxed); }
+TraceRing& Logger::getTraceRing() { return trace_ring; }
+
+const char* Logger::levelName(int level) {
+    switch (level) {
+    case trace: return "trace";
+    case debug: return "debug";
+    case info: return "info";
+    case warn: return "warn";
+    default: return "?";
+    }
+}
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include "include/MetricsSampler.h"
+using namespace std;
+
+MetricsSampler::MetricsSampler(int64_t n) {
+    interval = n;
+    clear();
+}
+
+void MetricsSampler::setInterval(int64_t n) {
+    assert(n > 0);
+    interval = n;
+}
+
+int64_t MetricsSampler::getInterval() { return interval; }
+int64_t MetricsSampler::getSampleCount() { return row_count; }
+const vector<string>& MetricsSampler::getColumnNames() { return column_names; }
+
+const vector<int64_t>& MetricsSampler::getColumn(const string& name) {
+    static const vector<int64_t> empty;
+    for (size_t i = 0; i < column_names.size(); i++)
+        if (column_names[i] == name)
+            return columns[i];
+    return empty;
+}
+
+void MetricsSampler::clear() {
+    tick_count = 0;
+    row_count = 0;
+    column_cursor = 0;
+    column_names.clear();
+    columns.clear();
+}
+
+void MetricsSampler::beginRow() {
+    row_count++;
+    column_cursor = 0;
+}
+
+void MetricsSampler::put(const char* name, int64_t value) {
+    if (column_cursor == column_names.size()) {     // first row defines the columns
+        assert(row_count == 1);
+        column_names.push_back(name);
+        columns.push_back(vector<int64_t>());
+    }
+    assert(column_names[column_cursor] == name);
+    columns[column_cursor++].push_back(value);
+}
+
+template <class ORAM>
+void MetricsSampler::sampleEngine(ORAM& oram) {
+    beginRow();
+    put("tick", tick_count);
+    put("access_count", oram.getAccessCount());
+    put("actual_access_count", oram.getActualAccessCount());
+    put("dummy_access_count", oram.getDummyAccessCount());
+    put("RA_memory_access_count", oram.getRA_MemoryAccessCount());
+    put("DA_memory_access_count", oram.getDA_MemoryAccessCount());
+    put("RA_path_read_count", oram.getRA_PathReadCount());
+    put("DA_path_read_count", oram.getDA_PathReadCount());
+    put("RA_path_write_count", oram.getRA_PathWriteCount());
+    put("DA_path_write_count", oram.getDA_PathWriteCount());
+    put("RA_real_block_read_count", oram.getRA_RealBlockReadCount());
+    put("DA_real_block_read_count", oram.getDA_RealBlockReadCount());
+    put("RA_real_block_write_count", oram.getRA_RealBlockWriteCount());
+    put("DA_real_block_write_count", oram.getDA_RealBlockWriteCount());
+    put("RA_dummy_block_read_count", oram.getRA_DummyBlockReadCount());
+    put("DA_dummy_block_read_count", oram.getDA_DummyBlockReadCount());
+    put("RA_dummy_block_write_count", oram.getRA_DummyBlockWriteCount());
+    put("DA_dummy_block_write_count", oram.getDA_DummyBlockWriteCount());
+    put("RA_stash_hit", oram.getRA_StashHit());
+    put("DA_stash_hit", oram.getDA_StashHit());
+    put("RA_stash_miss", oram.getRA_StashMiss());
+    put("DA_stash_miss", oram.getDA_StashMiss());
+    put("hit_latency", oram.getHitLatency());
+    put("ready_latency", oram.getReadyLatency());
+    put("stash_size", oram.stash.getCurrentStashSize());
+    put("stash_peak", oram.stash.getPeakOccupancy());
+}
+
+template <class HierORAM>
+void MetricsSampler::sampleHierarchy(HierORAM& oram) {
+    beginRow();
+    put("tick", tick_count);
+    put("access_count", oram.getAccessCount());
+    put("actual_access_count", oram.getActualAccessCount());
+    put("dummy_access_count", oram.getDummyAccessCount());
+    put("RA_memory_access_count", oram.getRA_MemoryAccessCount());
+    put("DA_memory_access_count", oram.getDA_MemoryAccessCount());
+    put("RA_path_read_count", oram.getRA_PathReadCount());
+    put("DA_path_read_count", oram.getDA_PathReadCount());
+    put("RA_path_write_count", oram.getRA_PathWriteCount());
+    put("DA_path_write_count", oram.getDA_PathWriteCount());
+    put("RA_real_block_read_count", oram.getRA_RealBlockReadCount());
+    put("DA_real_block_read_count", oram.getDA_RealBlockReadCount());
+    put("RA_real_block_write_count", oram.getRA_RealBlockWriteCount());
+    put("DA_real_block_write_count", oram.getDA_RealBlockWriteCount());
+    put("RA_dummy_block_read_count", oram.getRA_DummyBlockReadCount());
+    put("DA_dummy_block_read_count", oram.getDA_DummyBlockReadCount());
+    put("RA_dummy_block_write_count", oram.getRA_DummyBlockWriteCount());
+    put("DA_dummy_block_write_count", oram.getDA_DummyBlockWriteCount());
+    put("RA_stash_hit", oram.getRA_StashHitCount());
+    put("DA_stash_hit", oram.getDA_StashHitCount());
+    put("stash_hit", oram.getStashHitForHierORAM());
+    put("stash_miss", oram.getStashMissForHierORAM());
+    put("hit_latency", oram.getHitLatency());
+    put("ready_latency", oram.getReadyLatency());
+    put("data_RA_memory_access_count", oram.getRA_MemoryAccessCountOfDataORAM());
+    put("data_RA_stash_hit", oram.getRA_StashHitCountOfDataORAM());
+}
+
+void MetricsSampler::sample(PathORAM& oram) {
+    sampleEngine(oram);
+}
+
+void MetricsSampler::sample(PCDORAM& oram) {
+    sampleEngine(oram);
+    put("temporal_area_size", oram.stash.temporalSize());
+    put("candidate_area_size", oram.stash.candidateSize());
+    put("allocate_right_path_count", oram.getPathAllocateRightCount());
+    put("allocate_wrong_path_count", oram.getPathAllocateWrongCount());
+}
+
+void MetricsSampler::sample(HierarchicalPathORAM& oram) {
+    sampleHierarchy(oram);
+    put("stash_size", oram.getStashSize());
+}
+
+void MetricsSampler::sample(HierachicalPCDORAM& oram) {
+    sampleHierarchy(oram);
+    int64_t temporal_size = 0, candidate_size = 0;
+    for (int i = 0; i < oram.getHierarchy(); i++) {
+        temporal_size += oram.getLevel(i).stash.temporalSize();
+        candidate_size += oram.getLevel(i).stash.candidateSize();
+    }
+    put("stash_size", oram.getStashSize());
+    put("temporal_area_size", temporal_size);
+    put("candidate_area_size", candidate_size);
+    put("allocate_right_path_count", oram.getPathAllocateRightCountOfDataORAM());
+    put("allocate_wrong_path_count", oram.getPathAllocateWrongCountOfDataORAM());
+}
+
+void MetricsSampler::exportCSV(ostream& os) {
+    for (size_t c = 0; c < column_names.size(); c++)
+        os << (c ? "," : "") << column_names[c];
+    os << "\n";
+    for (int64_t r = 0; r < getSampleCount(); r++) {
+        for (size_t c = 0; c < columns.size(); c++)
+            os << (c ? "," : "") << columns[c][r];
+        os << "\n";
+    }
+    os.flush();
+}
+
+void MetricsSampler::exportJSON(ostream& os) {
+    os << "{\"interval\": " << interval << ", \"samples\": " << getSampleCount() << ", \"columns\": {";
+    for (size_t c = 0; c < columns.size(); c++) {
+        os << (c ? ", " : "") << "\"" << column_names[c] << "\": [";
+        for (size_t r = 0; r < columns[c].size(); r++)
+            os << (r ? ", " : "") << columns[c][r];
+        os << "]";
+    }
+    os << "}}" << endl;
+}
+
+bool MetricsSampler::exportCSV(const string& file_name) {
+    ofstream out(file_name.c_str());
+    if (!out.is_open())
+        return false;
+    exportCSV(out);
+    return true;
+}
+
+bool MetricsSampler::exportJSON(const string& file_name) {
+    ofstream out(file_name.c_str());
+    if (!out.is_open())
+        return false;
+    exportJSON(out);
+    return true;
+}
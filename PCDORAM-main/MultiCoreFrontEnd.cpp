@@ -0,0 +1,160 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "include/MultiCoreFrontEnd.h"
+using namespace std;
+
+MultiCoreFrontEnd::MultiCoreFrontEnd() {
+    core_count = 0;
+    time_scale = 1.0;
+    issue_rate = 0.0;
+    blocking = true;
+    makespan = 0;
+    served = 0;
+}
+
+MultiCoreFrontEnd::~MultiCoreFrontEnd() {
+#ifndef _WIN32
+    for (Trace& t : traces)
+        if (t.mapping)
+            munmap(t.mapping, t.mapped_size);
+#endif
+}
+
+bool MultiCoreFrontEnd::addCoreTrace(const string& file_name) {
+    Trace t;
+    t.file_name = file_name;
+    t.records = NULL;
+    t.length = 0;
+    t.mapping = NULL;
+    t.mapped_size = 0;
+#ifndef _WIN32
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TraceRecord)) {
+        close(fd);
+        return false;
+    }
+    t.mapped_size = st.st_size;
+    t.mapping = mmap(NULL, t.mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (t.mapping == MAP_FAILED)
+        return false;
+    madvise(t.mapping, t.mapped_size, MADV_SEQUENTIAL);
+    t.records = (const TraceRecord*)t.mapping;
+    t.length = t.mapped_size / sizeof(TraceRecord);
+#else
+    ifstream in(file_name.c_str(), ios::in | ios::binary);
+    if (!in)
+        return false;
+    TraceRecord r;
+    while (in.read((char*)&r, sizeof(r)))
+        t.buffer.push_back(r);
+    if (t.buffer.empty())
+        return false;
+    t.length = t.buffer.size();
+#endif
+    const TraceRecord* records = t.records ? t.records : t.buffer.data();
+    uint64_t duration = records[t.length - 1].timestamp - records[0].timestamp;
+    t.span = duration + max(t.length > 1 ? duration / (t.length - 1) : 0, (uint64_t)1);     // one mean gap between passes
+    traces.push_back(t);
+    for (Trace& tr : traces)        // buffers may have moved with the vector
+        if (!tr.buffer.empty())
+            tr.records = tr.buffer.data();
+    return true;
+}
+
+void MultiCoreFrontEnd::setCoreCount(int n) {
+    assert(n > 0);
+    core_count = n;
+}
+
+int MultiCoreFrontEnd::getCoreCount() { return core_count ? core_count : (int)traces.size(); }
+
+void MultiCoreFrontEnd::setTimeScale(double cycles_per_tick) {
+    assert(cycles_per_tick > 0);
+    time_scale = cycles_per_tick;
+}
+
+void MultiCoreFrontEnd::setIssueRate(double per_kilocycle) {
+    assert(per_kilocycle >= 0);
+    issue_rate = per_kilocycle;
+}
+
+void MultiCoreFrontEnd::setBlocking(bool b) { blocking = b; }
+
+void MultiCoreFrontEnd::prepareCores() {
+    assert(!traces.empty());
+    int n = getCoreCount();
+    int trace_count = traces.size();
+    cores.assign(n, Core());
+    for (int c = 0; c < n; c++) {
+        Core& core = cores[c];
+        core.trace = c % trace_count;
+        int replicas = (n - core.trace + trace_count - 1) / trace_count;     // cores sharing this trace
+        int64_t length = traces[core.trace].length;
+        core.cursor = length * (c / trace_count) / replicas;
+        core.remaining = length;
+        core.tick_offset = -(int64_t)traces[core.trace].records[core.cursor].timestamp;
+        core.last_issue = 0;
+        core.last_finish = 0;
+        core.served = 0;
+        core.stash_hits = 0;
+    }
+    queue_delay_hist.reset();
+    response_hist.reset();
+    makespan = 0;
+    served = 0;
+}
+
+const TraceRecord& MultiCoreFrontEnd::currentRecord(int core) {
+    return traces[cores[core].trace].records[cores[core].cursor];
+}
+
+uint64_t MultiCoreFrontEnd::nextIssueTime(int core) {
+    Core& c = cores[core];
+    uint64_t issue;
+    if (issue_rate > 0)
+        issue = c.served ? c.last_issue + (uint64_t)llround(1000.0 / issue_rate) : 0;
+    else
+        issue = (uint64_t)llround((int64_t)(currentRecord(core).timestamp + c.tick_offset) * time_scale);
+    if (blocking && c.served)
+        issue = max(issue, c.last_finish);
+    return issue;
+}
+
+int64_t MultiCoreFrontEnd::getServedCount() { return served; }
+uint64_t MultiCoreFrontEnd::getMakespan() { return makespan; }
+Histogram& MultiCoreFrontEnd::getQueueDelayHistogram() { return queue_delay_hist; }
+Histogram& MultiCoreFrontEnd::getResponseHistogram() { return response_hist; }
+
+void MultiCoreFrontEnd::report(ostream& os) {
+    os << "cores: " << cores.size() << ", requests: " << served << ", makespan: " << makespan << " cycles, throughput: "
+       << fixed << setprecision(3) << (makespan ? served * 1000.0 / makespan : 0.0) << " requests/kcycle" << endl;
+    queue_delay_hist.report(os, "queue delay");
+    response_hist.report(os, "response time");
+    for (int c = 0; c < (int)cores.size(); c++) {
+        Core& core = cores[c];
+        os << "core " << c << " (" << traces[core.trace].file_name << "): " << core.served << " requests, "
+           << core.stash_hits << " stash hits, mean response " << fixed << setprecision(1) << core.response_hist.getMean()
+           << ", p99 " << core.response_hist.percentile(99) << endl;
+    }
+}
+
+bool MultiCoreFrontEnd::writeTrace(const string& file_name, const vector<TraceRecord>& records) {
+    ofstream out(file_name.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    out.write((const char*)records.data(), records.size() * sizeof(TraceRecord));
+    return (bool)out;
+}
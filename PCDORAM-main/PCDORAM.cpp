@@ -16,6 +16,10 @@ using namespace std;
 
 PCDORAM::PCDORAM() {
     isOutPutLogFile = false;
+    fixed_seed = false;
+    replay_log = NULL;
+    prefetch_paths = true;
+    oblivious = ORAM_OBLIVIOUS;
 }
 
 
@@ -30,8 +34,7 @@ PCDORAM::~PCDORAM() { }
     st_s: stash size
 */
 int PCDORAM::configParameters(int64_t ds_s, int64_t oram_s, int bl_s, int bn_p, int st_s, bool isDebug) {	
-    cout << "configParameters: " << endl;
-    cout << oram_s << " " << ds_s << endl;
+    ORAM_INFO("configParameters: " << oram_s << " " << ds_s);
     assert(oram_s > ds_s);	
 
     data_set_size = ds_s;
@@ -51,41 +54,78 @@ int PCDORAM::configParameters(int64_t ds_s, int64_t oram_s, int bl_s, int bn_p,
     actual_ORAM_size = block_count * block_size;	// in Byte
 
     assert(st_s > block_num_per_bucket * level_count);
+    assert(block_num_per_bucket <= 64);		// one bit per slot in scanBucket()
+    assert(real_block_count < INT32_MAX && bucket_count < INT32_MAX);		// LocalCacheLine holds both in 32 bits
     stash.setMaxStashSize(st_s);	
 
     stash.setZvalue(block_num_per_bucket);
     stash.setL(level_count);
     stash.setBlocksize(block_size);
 
-    unsigned seed = chrono::system_clock::now().time_since_epoch().count();
+    if (!fixed_seed)
+        seed = chrono::system_clock::now().time_since_epoch().count();
+    if (replay_log)
+        seed = replay_log->traceSeed(seed);
     random_engine2.seed(seed);
     uniform_int_distribution<int> distribute_int1(leaf_count - 1, bucket_count - 1);
     distribute_int = distribute_int1;
 
-    cout << "block_count: " << block_count << endl;
-    cout << "real_block_count: " << real_block_count << endl;
-    cout << "bucket_count: " << bucket_count << endl;
-    cout << "level_count: " << level_count << endl;
-    cout << "leaf_count: " << leaf_count << endl;
-    cout << "actual_ORAM_size: " << actual_ORAM_size << endl;
+    ORAM_INFO("block_count: " << block_count << ", real_block_count: " << real_block_count
+        << ", bucket_count: " << bucket_count << ", level_count: " << level_count
+        << ", leaf_count: " << leaf_count << ", actual_ORAM_size: " << actual_ORAM_size);
 
     return 1;	
 }
 
+void PCDORAM::setSeed(unsigned s) {
+    seed = s;
+    fixed_seed = true;
+}
+
+unsigned PCDORAM::getSeed() { return seed; }
+
+void PCDORAM::setReplayLog(ReplayLog* log) { replay_log = log; }
+
+void PCDORAM::setEvictPathPolicy(int policy, size_t capacity) {
+    evict_backup_path.configure(capacity, policy);
+}
+
+void PCDORAM::setPathPrefetch(bool on) { prefetch_paths = on; }
+void PCDORAM::setObliviousStash(bool on) { oblivious = on; }
+bool PCDORAM::isObliviousStash() { return oblivious; }
+void PCDORAM::setIntegrity(int mode, int hash_bytes, int hash_cycles) { integrity.setMode(mode, hash_bytes, hash_cycles); }
+IntegrityTree& PCDORAM::getIntegrityTree() { return integrity; }
+
 int PCDORAM::generateRandomLeaf() {
     return distribute_int(random_engine2);
 }
 
 void PCDORAM::initialize() {
     present = new bool[real_block_count + 1];		
+    checked_out = new bool[real_block_count + 1];
     position_map = new int64_t[real_block_count + 1];
     program_address = new int64_t[block_count];
-    curPath_buffer = new int64_t[level_count * block_num_per_bucket];
+    bucket_valid = new uint64_t[bucket_count];
+    slot_leaf = new int32_t[block_count];
+    curPath_buffer = new LocalCacheLine[level_count * block_num_per_bucket];
     evict_queue = new int64_t[level_count * block_num_per_bucket];
+    evict_queue_leaf = new int32_t[level_count * block_num_per_bucket];
     evict_queue_count = new int[level_count];
+    path_buckets = new int64_t[level_count];
+    evict_bins.reserve(stash.getMaxStashSize() + level_count * block_num_per_bucket);
+    evict_order.reserve(stash.getMaxStashSize() + level_count * block_num_per_bucket);
+    depth_start.assign(level_count, 0);
     block_data = new int64_t[block_count];
     quantity_map = new int64_t[leaf_count];  
-    assert(present && position_map && program_address && curPath_buffer && evict_queue && evict_queue_count);
+    claimed_in_bucket.assign(bucket_count, 0);
+    claimed_buckets.reserve(stash.getMaxStashSize());
+    kick_slots.reserve(stash.getMaxStashSize());
+    kick_ids.reserve(stash.getMaxStashSize());
+    kick_groups.reserve(stash.getMaxStashSize());
+    kick_paths.reserve(stash.getMaxStashSize());
+    stash.setOblivious(oblivious);
+    slot_taken.assign(oblivious ? level_count * block_num_per_bucket : 0, 0);
+    assert(present && checked_out && position_map && program_address && bucket_valid && slot_leaf && curPath_buffer && evict_queue && evict_queue_leaf && evict_queue_count && path_buckets);
 
 
     if (isOutPutLogFile) {
@@ -99,7 +139,10 @@ void PCDORAM::initialize() {
 
 
     memset(present, 0, sizeof(bool) * (real_block_count + 1));		
+    memset(checked_out, 0, sizeof(bool) * (real_block_count + 1));
     memset(program_address, -1, sizeof(int64_t) * block_count);	
+    memset(bucket_valid, 0, sizeof(uint64_t) * bucket_count);
+    memset(slot_leaf, -1, sizeof(int32_t) * block_count);
     memset(block_data, -1, sizeof(int64_t) * block_count);
     memset(quantity_map, 0, sizeof(int64_t) * (leaf_count));  
 
@@ -109,11 +152,13 @@ void PCDORAM::initialize() {
         position_map[i] = rand_leaf;
         //	cout << position_map[i] << " --- +++ ";
     }
-    cout << endl;
+    if (integrity.isEnabled())
+        integrity.attach(bucket_count, level_count, block_num_per_bucket, block_size, program_address, slot_leaf, block_data, bucket_valid, seed);
 
     times = 0.0;
 
     last_path = -1;
+    evict_backup_path.clear();
 
     resetMetric();
 }
@@ -176,14 +221,30 @@ int64_t PCDORAM::getAvgHitLatency() { return ceil(hit_latency * 1.0 / access_cou
 
 int64_t PCDORAM::getAvgReadyLatency() { return ceil(ready_latency * 1.0 / access_count); }
 
+// most cycles one access can take: a path read and written, then the whole stash kicked out, each block on a path of its own; a delayed eviction skips the read
+uint64_t PCDORAM::getWorstCaseLatency() {
+    int64_t slots = 1ll * level_count * block_num_per_bucket, kicked = stash.getMaxStashSize();
+    return hit_directly_cycles + (hit_through_mem_cycles + write_back_cycles) * slots + remap_cycles
+         + (write_back_cycles + remap_cycles) * kicked
+         + (1 + kicked) * integrity.pathCyclesBound(hit_through_mem_cycles, write_back_cycles);
+}
+
 int64_t PCDORAM::getPathAllocateRightCount() { return allocate_right_path_count; }
 
 int64_t PCDORAM::getPathAllocateWrongCount() { return allocate_wrong_path_count; }
+int64_t PCDORAM::getDelayedEvictionCount() { return delayed_eviction_count; }
+
+Histogram& PCDORAM::getLatencyHistogram() { return latency_hist; }
+Histogram& PCDORAM::getTrafficHistogram() { return traffic_hist; }
+Histogram& PCDORAM::getOccupancyHistogram() { return stash.occupancy_hist; }
+Histogram& PCDORAM::getTemporalOccupancyHistogram() { return stash.temporal_occupancy_hist; }
+Histogram& PCDORAM::getCandidateOccupancyHistogram() { return stash.candidate_occupancy_hist; }
 
 void PCDORAM::resetMetric() {
 
     access_count = 0;			
     dummy_access_count = 0;
+    delayed_eviction_count = 0;
     actual_access_count = 0;
     max_freq = 0;
 
@@ -205,6 +266,11 @@ void PCDORAM::resetMetric() {
 
     hit_latency = 0;
     ready_latency = 0;
+
+    latency_hist.reset();
+    traffic_hist.reset();
+    stash.resetOccupancyHistograms();
+    integrity.resetCounters();
 }
 void PCDORAM::setDebug(bool debug) { this->debug = debug; }
 
@@ -217,15 +283,19 @@ void PCDORAM::displayPosMap() {
 }
 
 int64_t PCDORAM::access (int64_t id, short operation, int64_t data) {
+    ORAM_PROFILE_SCOPE(access);
     if (id < 0)
         id = real_block_count;
 
-    if (debug) {
-        cout << "real_block_count: " << real_block_count << "-------------" << "Interest Block: " << id << endl;
+    ORAM_DEBUG(debug, "real_block_count: " << real_block_count << "-------------" << "Interest Block: " << id);
+
+    uint64_t latency_before = hit_latency + ready_latency;
+
+    if (id >= real_block_count + 1) {
+        id = random_engine2() % real_block_count;
+        if (replay_log)
+            id = replay_log->traceBlock(id, 0, real_block_count - 1);
     }
-        
-    if (id >= real_block_count + 1)
-        id = rand() % real_block_count;
 
     assert(!stash.isFull() || (operation & dummy));
 
@@ -237,12 +307,23 @@ int64_t PCDORAM::access (int64_t id, short operation, int64_t data) {
     else
         actual_access_count++;
 
-    if (operation & write_back) {		
-        stash.putIntoCandidateArea(LocalCacheLine(id, position_map));
+    if (operation & write_back) {		// the LLC hands back a block it checked out, it joins the candidate area without an ORAM access
+        if (present[id]) {		// a second copy would shadow the one in the tree or stash
+            ORAM_WARN("write_back of block " << id << " that the ORAM still holds, ignored");
+            return finishAccess(0, latency_before);
+        }
+        if (oblivious) {
+            ObliviousBlock b = { id, position_map[id], 0, 1 };
+            obliviousInsert(stash.entries.data(), stash.entries.size(), b);
+            stash.entry_count++;
+            stash.candidate_count++;
+        }
+        else
+            stash.putIntoCandidateArea(LocalCacheLine(id, position_map[id]));
         present[id] = true;
-        if (debug)
-            cout << "Block is evicted from LLC." << endl;
-        return 0;		
+        checked_out[id] = false;
+        ORAM_DEBUG(debug, "Block is evicted from LLC.");
+        return finishAccess(0, latency_before);		
     }
 
     resetEvictQueue();
@@ -254,170 +335,236 @@ int64_t PCDORAM::access (int64_t id, short operation, int64_t data) {
     do {
         new_pos = distribute_int(random_engine2);
     } while (new_pos == cur_pos);
-    if (debug)
-        cout << "cur_pos: " << cur_pos << " new_pos: " << new_pos << endl;
+    if (replay_log)
+        new_pos = replay_log->traceLeaf(new_pos, leaf_count - 1, bucket_count - 1);
+    ORAM_DEBUG(debug, "cur_pos: " << cur_pos << " new_pos: " << new_pos);
+
+    if (oblivious)
+        return finishAccess(obliviousAccess(id, operation, data, cur_pos, new_pos), latency_before);
 
     bool isExist_pre = scanStash(id);
     if (isExist_pre) {		
         hit_latency += hit_directly_cycles;
-        if (debug)
-            cout << "Block that requested has found in the stash. No need to access ORAM." << endl;
+        ORAM_DEBUG(debug, "Block that requested has found in the stash. No need to access ORAM.");
         stash_hit[r_d_a_index]++;
     }
     else {  
         memory_access_count[r_d_a_index]++;
         stash_miss[r_d_a_index]++;
 
-        if (debug)
-            cout << "Block hasn't be found. Accessing ORAM..." << endl;
+        ORAM_DEBUG(debug, "Block hasn't be found. Accessing ORAM...");
 
         int64_t index = 0;		
         IO_traffic += readPath(id, cur_pos, index);		
         path_read_count[r_d_a_index]++;
-        evict_backup_path.push_back(cur_pos);		
 
         last_path = cur_pos;
 
-        if (debug)
-            cout << "temp size: " << stash.temporal_area.size() << endl;
+        ORAM_DEBUG(debug, "temp size: " << stash.temporal_area.size());
 
         if (!present[id]) {			// new block, not currently in ORAM
             if (operation & read) {
-                if (debug)
-                    cout << "ERROR! Reading non-existent block..." << endl;
+                ORAM_DEBUG(debug, "ERROR! Reading non-existent block...");
+            }
+            else if (checked_out[id]) {
+                ORAM_DEBUG(debug, "Block is checked out to the LLC, the write goes nowhere...");
             }
             else if (operation & write) {		// create a new block and append into stash
                 present[id] = true;
-                stash.putIntoCandidateArea(LocalCacheLine(id, position_map));
+                stash.putIntoCandidateArea(LocalCacheLine(id, position_map[id]));
 
-                if (debug)
-                    cout << "Creating a new block..." << endl;
+                ORAM_DEBUG(debug, "Creating a new block...");
             }
         }
         else {	// block exists
             if (operation & read) {
-                if (debug)
-                    cout << "Reading the requested block from ORAM tree..." << endl;
+                ORAM_DEBUG(debug, "Reading the requested block from ORAM tree...");
             }
             else if (operation & write) {		
                 block_data[index] = data;	
-                if (debug)
-                    cout << "Updating the block data..." << endl;
+                ORAM_DEBUG(debug, "Updating the block data...");
             }
         }
     }
     stash.updatePeakAndLastOccupancy();		// record the infomation of stash's occupancy
 
     remap(id, new_pos);  
+    if ((operation & checkout) && present[id]) {		// the LLC owns the block until it hands it back with write_back
+        if (!stash.removeFromCandidateArea(id))
+            stash.temporal_area.erase(id);
+        present[id] = false;
+        checked_out[id] = true;
+    }
 
     if (isExist_pre)
-        return IO_traffic;
+        return finishAccess(IO_traffic, latency_before);
 
-    if (debug)
-        cout << "stash size before: " << stash.getCurrentStashSize() << endl;
+    ORAM_DEBUG(debug, "stash size before: " << stash.getCurrentStashSize());
 
     if (operation & dummy) {
 
     }
 
     if (stash.isAlmostFull()) {
-        if (debug) {
-            cout << "isAlmostFull" << endl;
-            cout << "isTemporalAreaAlmostFull" << endl;
-            cout << "stash.tempsize before: " << stash.temporal_area.size() << endl;
-        }
+        ORAM_DEBUG(debug, "isAlmostFull, stash.tempsize before: " << stash.temporal_area.size());
 
         pickBlockstoEvict(cur_pos);
         IO_traffic += writePath(cur_pos);
         path_write_count[r_d_a_index]++;
-        if (debug)
-            cout << "stash.tempsize after: " << stash.temporal_area.size() << endl;
-
-        if (stash.isAlmostFull() && stash.candidate_area_key.size() > level_count) {
-            if (debug) {
-                cout << "isAlmostFull" << endl;
-                cout << "stash.cansize before: " << stash.candidate_area_key.size() << endl;
-                cout << "Merging hybrid blocks..." << endl;
-            }
-            hybridBlockMerge();
-            if (debug)
-                cout << "Kicking out hybrid blocks..." << endl;
-            IO_traffic += hybridBlockKickOut(true);
-            path_write_count[r_d_a_index]++;       
-
-            if (debug) {
-                cout << "Finishing kicking out..." << endl;
-                cout << "candidate_area size after: " << stash.candidate_area_key.size() << endl;
-            }
-        }
+        ORAM_DEBUG(debug, "stash.tempsize after: " << stash.temporal_area.size());
 
+        IO_traffic += kickOutIfAlmostFull();
     }
+    else
+        evict_backup_path.push(cur_pos);		// left empty, a later background eviction may write it back
 
-    if (debug)
-        cout << "stash size after: " << stash.getCurrentStashSize() << endl;
+    ORAM_DEBUG(debug, "stash size after: " << stash.getCurrentStashSize());
+    return finishAccess(IO_traffic, latency_before);
+}
+
+int64_t PCDORAM::finishAccess(int64_t IO_traffic, uint64_t latency_before) {
+    IO_traffic += closeIntegrity();
+    latency_hist.record(hit_latency + ready_latency - latency_before);
+    traffic_hist.record(IO_traffic);
+    stash.recordOccupancy();
     return IO_traffic;
 }
 
+// authenticates the path before its buckets are read or changed; content_read: the caller reads its blocks anyway
+int64_t PCDORAM::openIntegrity(int64_t leaf_label, bool content_read) {
+    if (!integrity.isEnabled() || integrity.getOpenPath() == leaf_label)
+        return 0;
+    int64_t traffic = closeIntegrity();
+    IntegrityTree::Cost c = integrity.open(leaf_label, content_read);
+    if (!integrity.isModeled())
+        return traffic;
+    hit_latency += c.lines * hit_through_mem_cycles + c.hashes * integrity.getHashCycles();
+    return traffic + c.lines;
+}
+
+// rewrites the open path's hashes if it changed
+int64_t PCDORAM::closeIntegrity() {
+    if (!integrity.isEnabled())
+        return 0;
+    IntegrityTree::Cost c = integrity.close();
+    if (!integrity.isModeled())
+        return 0;
+    ready_latency += c.lines * write_back_cycles + c.hashes * integrity.getHashCycles();
+    return c.lines;
+}
+
 int64_t PCDORAM::generateFromEvictBackupPath() {
-    if (evict_backup_path.size() == 0)
+    if (evict_backup_path.empty())
         return distribute_int(random_engine2);
-    int64_t leaf_index = (rand() % evict_backup_path.size());
-    int64_t leaf = evict_backup_path[leaf_index];
-    vector<int64_t>::iterator it = evict_backup_path.begin() + leaf_index;
-    evict_backup_path.erase(it);	
-    return leaf;
+    size_t pos = evict_backup_path.choose(random_engine2, [this](int64_t leaf) { return freeSlotsOnPath(leaf); });
+    if (replay_log && evict_backup_path.getPolicy() == EvictPathPool::random_path)
+        pos = replay_log->traceEvict(pos, 0, evict_backup_path.getSpan() - 1);
+    return evict_backup_path.removeAt(pos);
 }
 
-int64_t PCDORAM::readPath(int64_t interest, int64_t leaf_label, int64_t& index) {
-    if (debug) {
-        cout << "Read Phase - interest block: " << interest << endl;
-        cout << "Before read, currentStashsize: "<< stash.getCurrentStashSize() << "_+_+_+_+__+_+___+_+++" << endl;
+int PCDORAM::freeSlotsOnPath(int64_t leaf_label) {
+    int free_slots = level_count * block_num_per_bucket;
+    int64_t bucket_index = leaf_label;
+    for (int i = 0; i < level_count; i++) {
+        free_slots -= popCount(bucket_valid[bucket_index]);
+        bucket_index = (bucket_index - 1) / 2;
     }
-    int cross_layer = 0;
+    return free_slots;
+}
 
-    int64_t bucket_index = leaf_label;
-    for (int i = cross_layer; i < level_count; i++) {		
+// write a previously read path back from the stash without reading it again; 0 if no stashed block fits on it
+int64_t PCDORAM::delayedEviction() {
+    uint64_t latency_before = hit_latency + ready_latency;
+    int64_t leaf = generateFromEvictBackupPath();
+    int64_t placed = stash.temporalSize();
+    r_d_a_index = 1;
+    resetEvictQueue();
+    if (oblivious)
+        obliviousEvict(leaf);
+    else
+        pickBlockstoEvict(leaf);
+    placed -= stash.temporalSize();
+    if (placed == 0)
+        return 0;
+    ORAM_DEBUG(debug, "Delayed eviction along path " << leaf << ", placed " << placed << " blocks.");
+    int64_t IO_traffic = writePath(leaf);
+    path_write_count[r_d_a_index]++;
+    delayed_eviction_count++;
+    IO_traffic += kickOutIfAlmostFull();
+    return finishAccess(IO_traffic, latency_before);
+}
 
-        assert(bucket_index || (bucket_index == 0 && i == level_count - 1));
-        for (int j = 0; j < block_num_per_bucket; j++) {
-            int64_t id = program_address[bucket_index * block_num_per_bucket + j];
-            if (id == interest) {		
-                block_read_count[r_d_a_index][0]++;
-                index = bucket_index * block_num_per_bucket + j;
-                stash.putIntoCandidateArea(LocalCacheLine(id, position_map));
-                program_address[bucket_index * block_num_per_bucket + j] = -1;
-            }
-            else if (id != -1) {
-                block_read_count[r_d_a_index][0]++;
-                stash.putIntoTemporalArea(LocalCacheLine(id, position_map));
-                program_address[bucket_index * block_num_per_bucket + j] = -1;
-            }
-            else
-                block_read_count[r_d_a_index][1]++;
+int64_t PCDORAM::kickOutIfAlmostFull() {
+    if (!stash.isAlmostFull() || stash.candidateSize() <= level_count)
+        return 0;
+    ORAM_DEBUG(debug, "isAlmostFull, stash.cansize before: " << stash.candidateSize() << ". Merging hybrid blocks...");
+    hybridBlockMerge();
+    ORAM_DEBUG(debug, "Kicking out hybrid blocks...");
+    int64_t traffic = hybridBlockKickOut();
+    path_write_count[r_d_a_index]++;
+    ORAM_DEBUG(debug, "Finishing kicking out, candidate_area size after: " << stash.candidateSize());
+    return traffic;
+}
+
+void PCDORAM::prefetch(int64_t id) {
+    if (!prefetch_paths || id < 0 || id > real_block_count)
+        return;
+    pathBuckets(position_map[id], level_count, path_buckets);
+    prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+}
+
+int64_t PCDORAM::readPath(int64_t interest, int64_t leaf_label, int64_t& index) {
+    ORAM_PROFILE_SCOPE(read_path);
+    ORAM_DEBUG(debug, "Read Phase - interest block: " << interest << ", before read, currentStashsize: " << stash.getCurrentStashSize());
+    int cross_layer = 0;
+    int path_real = 0;
+
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<0>(program_address, path_buckets + cross_layer, level_count - cross_layer, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, true);
+    integrity.markDirty();
+    for (int i = level_count - 1; i >= cross_layer; i--) {		// leaf to root
+        int64_t bucket_index = path_buckets[i];
+        uint64_t real = bucket_valid[bucket_index];		// empty buckets need no scan
+        int n = popCount(real);
+        block_read_count[r_d_a_index][0] += n;
+        block_read_count[r_d_a_index][1] += block_num_per_bucket - n;
+        if (n == 0)
+            continue;
+        int64_t* slots = program_address + bucket_index * block_num_per_bucket;
+        int32_t* leaves = slot_leaf + bucket_index * block_num_per_bucket;
+        int hit;
+        scanBucket(slots, block_num_per_bucket, interest, hit);
+        if (hit >= 0) {		
+            index = bucket_index * block_num_per_bucket + hit;
+            stash.putIntoCandidateArea(LocalCacheLine(interest, leaves[hit]));
+            real &= ~(1ull << hit);
         }
-        if (bucket_index == 1)
-            bucket_index = 0;
-        else
-            bucket_index = ceil((bucket_index - 2) * 1.0 / 2);		
+        for (uint64_t m = real; m; m &= m - 1)
+            curPath_buffer[path_real++] = LocalCacheLine(slots[lowestBit(m)], leaves[lowestBit(m)]);
+        fill(slots, slots + block_num_per_bucket, -1);
+        bucket_valid[bucket_index] = 0;
     }
-    if (debug)
-        cout << "After read, currentStashsize: " << stash.getCurrentStashSize() << "_+_+_+_+__+_+___+_+++" << endl;
+    for (int k = 0; k < path_real; k++)		// temporal area insertion batched after the scan
+        stash.putIntoTemporalArea(curPath_buffer[k]);
+    ORAM_DEBUG(debug, "After read, currentStashsize: " << stash.getCurrentStashSize());
     hit_latency += hit_through_mem_cycles * 1ll * (level_count - cross_layer) * block_num_per_bucket;
-    return 1ll * (level_count - cross_layer) * block_num_per_bucket;
+    return traffic + 1ll * (level_count - cross_layer) * block_num_per_bucket;
 }
 
 bool PCDORAM::scanStash(int64_t interest) {		
+    ORAM_PROFILE_SCOPE(scan_stash);
     bool isFound = false;
     if (stash.candidate_area_key.find(interest) != stash.candidate_area_key.end()) {
-        stash.putIntoCandidateArea(LocalCacheLine(interest, position_map));
+        stash.putIntoCandidateArea(LocalCacheLine(interest, position_map[interest]));
         isFound = true;
         return isFound;
     }
 
-    if (stash.temporal_area.find(interest) != stash.temporal_area.end()) {
+    if (stash.temporal_area.erase(interest)) {
         isFound = true;
-        stash.putIntoCandidateArea(LocalCacheLine(interest, position_map));
-        stash.temporal_area.erase(interest);
+        stash.putIntoCandidateArea(LocalCacheLine(interest, position_map[interest]));
         return isFound;
     }
 
@@ -426,17 +573,36 @@ bool PCDORAM::scanStash(int64_t interest) {
 
 void PCDORAM::remap(int64_t interest, int64_t new_leaf) {
     position_map[interest] = new_leaf;
+    if (!oblivious) {		// the oblivious lookup updates the stash entry itself
+        auto key = stash.candidate_area_key.find(interest);		// remapped blocks sit in the candidate area
+        if (key != stash.candidate_area_key.end())
+            key->second->leaf = new_leaf;
+    }
     ready_latency += remap_cycles;
 }
 
 void PCDORAM::resetEvictQueue() {
     memset(evict_queue, -1, sizeof(int64_t) * level_count * block_num_per_bucket);	
+    memset(evict_queue_leaf, -1, sizeof(int32_t) * level_count * block_num_per_bucket);
     memset(evict_queue_count, 0, sizeof(int) * level_count);
 }
 
+void PCDORAM::rebuildBucketMeta() {
+    for (int64_t b = 0; b < bucket_count; b++) {
+        bucket_valid[b] = 0;
+        for (int j = 0; j < block_num_per_bucket; j++) {
+            int64_t id = program_address[b * block_num_per_bucket + j];
+            bucket_valid[b] |= (uint64_t)(id != -1) << j;
+            slot_leaf[b * block_num_per_bucket + j] = id == -1 ? -1 : position_map[id];
+        }
+    }
+    if (integrity.isEnabled())
+        integrity.rebuild();
+}
+
 int PCDORAM::locateTheIntersectionForTmpArea(LocalCacheLine block, int64_t cur_pos) {
     assert(block.id >= 0);
-    int64_t block_pos = *(block.position); 
+    int64_t block_pos = block.leaf; 
 
     if (block_pos > cur_pos)		
         swap(block_pos, cur_pos);
@@ -472,84 +638,228 @@ int PCDORAM::findSpaceOfBucketOnPath(int cross_point) {
 }
 
 void PCDORAM::pickBlockstoEvict(int64_t cur_pos) {
-    int intersection = -1;
-    int deepestNode = -1;
-    auto tem_iter = stash.temporal_area.begin();
-    while (tem_iter != stash.temporal_area.end()) {
-        LocalCacheLine block = (*tem_iter).second;
-        intersection = locateTheIntersectionForTmpArea(block, cur_pos);
-        deepestNode = findSpaceOfBucketOnPath(intersection);
-        if (deepestNode != -1) { 
-            evict_queue[deepestNode * block_num_per_bucket + evict_queue_count[deepestNode]] = block.id;
-            evict_queue_count[deepestNode]++;
-            tem_iter = stash.temporal_area.erase(tem_iter);		
+    ORAM_PROFILE_SCOPE(pick_blocks_to_evict);
+    int64_t bucket_index = cur_pos;
+    for (int i = level_count - 1; i >= 0; i--) {		// slots still holding blocks are not available
+        evict_queue_count[i] += popCount(bucket_valid[bucket_index]);
+        bucket_index = (bucket_index - 1) / 2;
+    }
+
+    // bin the temporal area by deepest legal level, then fill leaf to root deepest-first (maximal placement)
+    evict_bins.clear();
+    fill(depth_start.begin(), depth_start.end(), 0);
+    for (int i = 0; i < (int)stash.temporal_area.size(); i++) {
+        int depth = deepestSharedLevel(stash.temporal_area[i].leaf, cur_pos, leaf_count, level_count);
+        evict_bins.push_back(make_pair(depth, i));
+        depth_start[depth]++;
+    }
+    int start = 0;
+    for (int depth = level_count - 1; depth >= 0; depth--) {
+        int n = depth_start[depth];
+        depth_start[depth] = start;
+        start += n;
+    }
+    evict_order.resize(evict_bins.size());
+    for (auto& b : evict_bins)
+        evict_order[depth_start[b.first]++] = b;
+
+    size_t next = 0;
+    for (int level = level_count - 1; level >= 0 && next < evict_order.size(); level--) {
+        while (evict_queue_count[level] < block_num_per_bucket && next < evict_order.size() && evict_order[next].first >= level) {
+            LocalCacheLine& line = stash.temporal_area[evict_order[next].second];
+            evict_queue[level * block_num_per_bucket + evict_queue_count[level]] = line.id;
+            evict_queue_leaf[level * block_num_per_bucket + evict_queue_count[level]] = line.leaf;
+            evict_queue_count[level]++;
+            stash.temporal_area.mark(evict_order[next].second);
+            next++;
         }
-        else
-            tem_iter++;
     }
+    stash.temporal_area.removeMarked();
 }
 
 int64_t PCDORAM::writePath(int leaf_label) {
-    int64_t traffic = 0;
-    int64_t bucket_index = leaf_label;
-    for (int i = 0; i < level_count; i++) {		
-        assert(bucket_index || (bucket_index == 0 && i == level_count - 1));
+    ORAM_PROFILE_SCOPE(write_path);
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<1>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, false);		// free after readPath of the same path, not for delayed eviction
+    integrity.markDirty();
+    for (int i = level_count - 1; i >= 0; i--) {		
+        int64_t bucket_index = path_buckets[i];
+        int next = i * block_num_per_bucket;		// queued blocks only fill free slots
+        int end = next + block_num_per_bucket;
+        uint64_t valid = bucket_valid[bucket_index];
         for (int j = 0; j < block_num_per_bucket; j++) {
             traffic++;
-            int64_t id = evict_queue[(level_count - 1 - i) * block_num_per_bucket + j];
-            if (id == -1)
-                block_write_count[r_d_a_index][1]++;
-            else
-                block_write_count[r_d_a_index][0]++;
-            program_address[bucket_index * block_num_per_bucket + j] = id;
-
+            if ((valid >> j) & 1)
+                continue;
+            while (next < end && evict_queue[next] == -1)
+                next++;
+            if (next < end) {
+                program_address[bucket_index * block_num_per_bucket + j] = evict_queue[next];
+                slot_leaf[bucket_index * block_num_per_bucket + j] = evict_queue_leaf[next];
+                valid |= 1ull << j;
+                next++;
+            }
         }
-        if (bucket_index == 1)
-            bucket_index = 0;
-        else
-            bucket_index = ceil((bucket_index - 2) * 1.0 / 2);		
+        bucket_valid[bucket_index] = valid;
+        int n = popCount(valid);
+        block_write_count[r_d_a_index][0] += n;
+        block_write_count[r_d_a_index][1] += block_num_per_bucket - n;
     }
 
     ready_latency += write_back_cycles * 1ll * level_count * block_num_per_bucket;
     return traffic;
 }
 
+/*
+    Oblivious mode: the path is read even on a stash hit, and one pass over
+    every stash entry looks the block up, moves it from the temporal to the
+    candidate area or counts the access, remaps it and checks it out. When to
+    evict, and which paths a kick-out takes, still follow the stash occupancy
+    and the per-frequency counts, as in the regular mode.
+*/
+int64_t PCDORAM::obliviousAccess(int64_t id, short operation, int64_t data, int64_t cur_pos, int64_t new_pos) {
+    memory_access_count[r_d_a_index]++;
+    int64_t index = -1;
+    int64_t IO_traffic = obliviousReadPath(id, cur_pos, index);
+    path_read_count[r_d_a_index]++;
+    last_path = cur_pos;
+
+    bool hit = present[id] & (index < 0);		// counted for the report only
+    stash_hit[r_d_a_index] += hit;
+    stash_miss[r_d_a_index] += !hit;
+
+    bool update = (operation & write) != 0;
+    for (int i = 0; i < level_count; i++) {		// touch every payload on the path, update the requested one
+        for (int j = 0; j < block_num_per_bucket; j++) {
+            int64_t slot = path_buckets[i] * block_num_per_bucket + j;
+            block_data[slot] = oselect(update & (slot == index), data, block_data[slot]);
+        }
+    }
+
+    // a newly written block takes the spare last entry and joins the candidate area in the pass below
+    vector<ObliviousBlock>& e = stash.entries;
+    bool create = !present[id] & !checked_out[id] & update;
+    e.back().id = oselect(create, id, e.back().id);
+    stash.entry_count += create;
+    present[id] |= create;
+    bool out = ((operation & checkout) != 0) & present[id];
+    int64_t promoted = 0;
+    for (size_t k = 0; k < e.size(); k++) {
+        bool match = e[k].id == id;
+        promoted += match & (e[k].tag == 0);
+        e[k].leaf = oselect(match, new_pos, e[k].leaf);
+        e[k].tag = oselect(match & !out, e[k].tag + 1, oselect(match, 0, e[k].tag));
+        e[k].id = oselect(match & out, -1, e[k].id);
+    }
+    stash.candidate_count += promoted - out;
+    stash.entry_count -= out;
+    present[id] &= !out;
+    checked_out[id] |= out;
+
+    stash.updatePeakAndLastOccupancy();
+    remap(id, new_pos);
+
+    if (stash.isAlmostFull()) {
+        obliviousEvict(cur_pos);
+        IO_traffic += writePath(cur_pos);
+        path_write_count[r_d_a_index]++;
+        IO_traffic += kickOutIfAlmostFull();
+    }
+    else {
+        evict_backup_path.push(cur_pos);		// left empty, a later background eviction may write it back
+        obliviousCompact(e.data(), e.size());		// the path entries and the spare join the stash
+    }
+    return IO_traffic;
+}
+
+// copies every slot of the path into the path entries at the end of the stash, as temporal blocks
+int64_t PCDORAM::obliviousReadPath(int64_t interest, int64_t leaf_label, int64_t& index) {
+    ORAM_PROFILE_SCOPE(read_path);
+    vector<ObliviousBlock>& e = stash.entries;
+    int path_slots = level_count * block_num_per_bucket;
+    assert(stash.entry_count <= (int)e.size() - 1 - path_slots);
+    ObliviousBlock* path = &e[e.size() - 1 - path_slots];
+
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, true);
+    integrity.markDirty();
+    int loaded = 0, k = 0;
+    for (int i = level_count - 1; i >= 0; i--) {		// leaf to root, as readPath
+        int64_t *slots = program_address + path_buckets[i] * block_num_per_bucket;
+        int32_t *leaves = slot_leaf + path_buckets[i] * block_num_per_bucket;
+        for (int j = 0; j < block_num_per_bucket; j++, k++) {
+            int64_t id = slots[j];
+            bool real = id != -1;
+            block_read_count[r_d_a_index][0] += real;
+            block_read_count[r_d_a_index][1] += !real;
+            index = oselect(id == interest, path_buckets[i] * block_num_per_bucket + j, index);
+            path[k].id = id;
+            path[k].leaf = leaves[j];
+            path[k].tag = 0;
+            slots[j] = -1;
+            loaded += real;
+        }
+        bucket_valid[path_buckets[i]] = 0;
+    }
+    stash.entry_count += loaded;
+    hit_latency += hit_through_mem_cycles * 1ll * path_slots;
+    return traffic + path_slots;
+}
+
+// temporal blocks only, into the free slots of the path; returns how many were placed
+int64_t PCDORAM::obliviousEvict(int64_t cur_pos) {
+    ORAM_PROFILE_SCOPE(pick_blocks_to_evict);
+    assert(level_count <= 64);
+    int64_t free[64];
+    int64_t bucket_index = cur_pos;
+    for (int i = level_count - 1; i >= 0; i--) {		// slots still holding blocks are not available
+        free[i] = block_num_per_bucket - popCount(bucket_valid[bucket_index]);
+        bucket_index = (bucket_index - 1) / 2;
+    }
+    int64_t placed = obliviousEvictPath(stash.entries.data(), stash.entries.size(), cur_pos, leaf_count, level_count, block_num_per_bucket, free,
+                                        [](const ObliviousBlock& b) { return (b.id != -1) & (b.tag == 0); }, slot_taken.data(), evict_queue, evict_queue_leaf);
+    stash.entry_count -= placed;
+    return placed;
+}
+
 int64_t PCDORAM::backgroundEviction() {
     int64_t traffic = 0;
     while (stash.isAlmostFull()) {
-        if (debug)
-            cout << "Background eviction..." << endl;
+        if (!evict_backup_path.empty()) {
+            int64_t delayed = delayedEviction();
+            if (delayed) {
+                traffic += delayed;
+                continue;
+            }
+        }
+        ORAM_DEBUG(debug, "Background eviction...");
         traffic += access(real_block_count, PCDORAM::dummy, -1);
     }
     return traffic;
 }
 
 void PCDORAM::hybridBlockMerge() {
+    ORAM_PROFILE_SCOPE(hybrid_block_merge);
 
-    freq_cnt.clear();  
-
+#if ORAM_LOG_LEVEL <= ORAM_LOG_LEVEL_TRACE
     if (debug) {
-        cout << "before merge: ";
-        for (auto& ele : stash.candidate_area_key) {
-            cout << "(" << stash.candidate_area_key_freq[ele.second->id] << ", " << ele.second->id << ", " << *(ele.second->position) << ")";
-        }
-        cout << endl;
-
-        cout << "stash.candidate_area_key.size: " << stash.candidate_area_key.size() << endl;
-        cout << "stash.candidate_area_freq.size: " << stash.candidate_area_freq.size() << endl;
-        for (auto& f_ele : stash.candidate_area_freq) {
-            cout << "f_ele.size: " << f_ele.second.size() << " ";
-        }
-        cout << endl;
-    }
-
-    max_freq = 0;
-
-    for (auto& f_ele : stash.candidate_area_freq) {
-        freq_cnt.insert(make_pair(f_ele.first, f_ele.second.size()));
-        max_freq = max(max_freq, f_ele.first);
+        ostringstream os;
+        os << "before merge: ";
+        for (auto& ele : stash.candidate_area_key)
+            os << "(" << stash.candidate_area_key_freq[ele.second->id] << ", " << ele.second->id << ", " << ele.second->leaf << ")";
+        os << " f_ele.size:";
+        for (auto& f_ele : stash.candidate_area_freq)
+            os << " " << f_ele.second.size();
+        ORAM_TRACE(debug, os.str());
     }
+#endif
+    ORAM_DEBUG(debug, "stash.candidate_area_key.size: " << stash.candidate_area_key.size() << ", stash.candidate_area_freq.size: " << stash.candidate_area_freq.size());
 
+    max_freq = stash.candidate_max_freq;		// per-frequency counts are kept up to date by Stash5
 }
 
 int PCDORAM::locateTheIntersection(int64_t block_pos, int64_t cur_pos) {
@@ -581,121 +891,145 @@ int PCDORAM::locateTheIntersection(int64_t block_pos, int64_t cur_pos) {
 }
 
 
-int64_t PCDORAM::hybridBlockKickOut(bool isHalf) {
-    
-    int64_t traffic = 0;
-    int cnt = 0;		
-    int erase_cnt = 0;
-
-    int needed_place = stash.candidate_area_key.size();   
-    int erase_count = 0;
-
-    //int freq_cnt_size = freq_cnt.size();
-    //int evict_freq_size = 0;
-    
-    for (auto f_iter = freq_cnt.begin(); f_iter != freq_cnt.end();) {
-        
-
-
-        pair<int64_t, int64_t> ele = *f_iter;
-        int64_t freq = ele.first;
-        int64_t f_cnt = ele.second;
-
-        vector<pair<int64_t, int64_t>> space;		// <target_left, index>
-        int cur_needed_place = f_cnt; 
-        int64_t cur_erase_cnt = 0; 
-        
-        bool isFind = false;
-        int64_t target_leaf = findTheBestFitPathForEvict(f_cnt,isFind); 
-        if (isFind) { 
-            allocate_right_path_count++;
-        }
-        else {
-            allocate_wrong_path_count++;
-        }
-        int bucket_index = target_leaf;
-
-
-        while (cur_needed_place > 0) { 
-            bucket_index = target_leaf;
-            for (int i = 0; i < level_count; i++) {  
-                assert(bucket_index || (bucket_index == 0 && i == level_count - 1));
-                for (int j = 0; j < block_num_per_bucket; j++) {
-                    int64_t t_id = program_address[bucket_index * block_num_per_bucket + j];
-                    if (t_id != -1)
-                        continue;
-                    space.emplace_back(make_pair(target_leaf, bucket_index * block_num_per_bucket + j));
-                    program_address[bucket_index * block_num_per_bucket + j] = 1; 
-                    if (cur_needed_place == 0)
-                        break;
+/*
+    Places every candidate block, lowest access frequency first, in two
+    passes. Planning packs each frequency group onto best-fit paths, taking
+    the free slots walking up from the leaf; claims only record a per-bucket
+    count, which bestFitLeaf subtracts on its next scan. The commit then writes
+    the planned slots path by path. Blocks that find no free slot on any path
+    stay in the candidate area.
+*/
+int64_t PCDORAM::hybridBlockKickOut() {
+    ORAM_PROFILE_SCOPE(hybrid_block_kick_out);
+
+    refreshQuantityMap(0, 0);
+    kick_slots.clear();
+    kick_paths.clear();
+    orderCandidates();
+    bool full = false;
+    for (size_t g = 0; g < kick_groups.size() && !full; g++) {
+        int64_t cur_needed_place = kick_groups[g];
+        while (cur_needed_place > 0) {
+            bool isFind = false;
+            int64_t target_leaf = bestFitLeaf(cur_needed_place, isFind);
+            if (replay_log)
+                target_leaf = replay_log->traceEvict(target_leaf, leaf_count - 1, bucket_count - 1);
+            if (isFind)
+                allocate_right_path_count++;
+            else
+                allocate_wrong_path_count++;
+
+            size_t path_start = kick_slots.size();
+            int64_t bucket_index = target_leaf;
+            for (int i = 0; i < level_count && cur_needed_place > 0; i++) {
+                uint64_t free_slots = ~bucket_valid[bucket_index] & bucketMask(block_num_per_bucket);
+                for (int k = claimed_in_bucket[bucket_index]; k > 0; k--)		// planned claims take the lowest free slots
+                    free_slots &= free_slots - 1;
+                int claimed = 0;
+                for (; free_slots && cur_needed_place > 0; free_slots &= free_slots - 1) {
+                    kick_slots.push_back(bucket_index * block_num_per_bucket + lowestBit(free_slots));
+                    cur_needed_place--;
+                    claimed++;
                 }
-                if (bucket_index == 1)
-                    bucket_index = 0;
-                else
-                    bucket_index = ceil((bucket_index - 2) * 1.0 / 2);		
-                if (cur_needed_place == 0)
-                    break;
+                if (claimed)
+                    claimSlots(bucket_index, claimed);
+                bucket_index = (bucket_index - 1) / 2;
             }
-            if (cur_needed_place > 0) {
-                target_leaf = findTheBestFitPathForEvict(cur_needed_place, isFind);
-                if (isFind) {
-                    allocate_right_path_count++;
-                }
-                else {
-                    allocate_wrong_path_count++;
-                }
+            if (kick_slots.size() == path_start) {		// even the roomiest path is full
+                ORAM_WARN("Kick-out found no free slot, " << kick_ids.size() - kick_slots.size() << " candidate blocks stay in the stash");
+                full = true;
+                break;
             }
+            kick_paths.push_back(make_pair(target_leaf, kick_slots.size()));
         }
+    }
 
-
-        int i = 0;
-        auto data_list = stash.candidate_area_freq[freq];
-        for (auto iter = data_list.begin(); iter != data_list.end(); iter++) {
-            int64_t block_id = iter->id;
-            program_address[space[i].second] = block_id;
-            ready_latency += write_back_cycles;
-            remap(block_id, space[i].first);
-            stash.candidate_area_key.erase(block_id);
-            stash.candidate_area_key_freq.erase(block_id);  
-            i++;
-
-            cnt++;
-            block_write_count[r_d_a_index][0]++;
+    int64_t integrity_traffic = 0;
+    size_t k = 0;
+    for (auto& path : kick_paths) {
+        evict_backup_path.remove(path.first);		// its free slots are taken
+        integrity_traffic += openIntegrity(path.first, false);		// an extra hash chain per kick-out path
+        integrity.markDirty();
+        for (; k < path.second; k++) {
+            int64_t slot = kick_slots[k];
+            program_address[slot] = kick_ids[k];
+            slot_leaf[slot] = path.first;
+            bucket_valid[slot / block_num_per_bucket] |= 1ull << (slot % block_num_per_bucket);
+            remap(kick_ids[k], path.first);
         }
-
-        stash.candidate_area_freq[freq].clear();
-        stash.candidate_area_freq.erase(freq);
-        f_iter = freq_cnt.erase(f_iter);  
     }
+    int64_t cnt = kick_slots.size();
+    ready_latency += write_back_cycles * cnt;
+    block_write_count[r_d_a_index][0] += cnt;
+
+    for (int64_t b : claimed_buckets)
+        claimed_in_bucket[b] = 0;
+    claimed_buckets.clear();
+    if (oblivious) {		// the placed blocks are the leading entries
+        vector<ObliviousBlock>& e = stash.entries;
+        for (int64_t k = 0; k < cnt; k++) {
+            e[k].id = -1;
+            e[k].tag = 0;
+        }
+        stash.entry_count -= cnt;
+        stash.candidate_count -= cnt;
+        obliviousCompact(e.data(), e.size());
+    }
+    else if (full) {
+        for (int64_t k = 0; k < cnt; k++)
+            stash.removeFromCandidateArea(kick_ids[k]);
+    }
+    else
+        stash.clearCandidateArea();
+    max_freq = stash.candidate_max_freq;
+    return cnt + integrity_traffic;
+}
 
-
-    if (freq_cnt.size() == 0)
-        max_freq = 0;
-    else {
-        max_freq = freq_cnt.rbegin()->second;
+/*
+    kick_ids: the candidate blocks, lowest access frequency first; kick_groups:
+    how many share each frequency. In oblivious mode the candidates are
+    compacted to the front of the stash and sorted there by frequency; their
+    count and the group sizes pick the kick-out paths, which show anyway.
+*/
+void PCDORAM::orderCandidates() {
+    kick_ids.clear();
+    kick_groups.clear();
+    if (!oblivious) {
+        for (int64_t freq = 1; freq <= stash.candidate_max_freq; freq++) {
+            if (stash.candidate_freq_count[freq] == 0)
+                continue;
+            for (auto& line : stash.candidate_area_freq[freq])
+                kick_ids.push_back(line.id);
+            kick_groups.push_back(stash.candidate_freq_count[freq]);
+        }
+        return;
     }
+    vector<ObliviousBlock>& e = stash.entries;
+    obliviousCompact(e.data(), e.size(), [](const ObliviousBlock& b) { return (b.id != -1) & (b.tag > 0); });
+    int64_t c = stash.candidate_count;
+    for (int64_t k = 0; k < c; k++)
+        e[k].key = e[k].tag;
+    obliviousSort(e.data(), c);
+    for (int64_t k = 0; k < c; k++) {
+        if (k == 0 || e[k].key != e[k - 1].key)
+            kick_groups.push_back(0);
+        kick_groups.back()++;
+        kick_ids.push_back(e[k].id);
+    }
+}
 
-    traffic = cnt;
-    return traffic;
+// n free slots of bucket_index were planned: O(1), bestFitLeaf takes them off every leaf below
+void PCDORAM::claimSlots(int64_t bucket_index, int n) {
+    if (claimed_in_bucket[bucket_index] == 0)
+        claimed_buckets.push_back(bucket_index);
+    claimed_in_bucket[bucket_index] += n;
 }
 
 void PCDORAM::refreshQuantityMap(int cur_bucket, int numofPrev) {
-
-    if (cur_bucket >= (leaf_count - 1)) {
-        for (int i = 0; i < block_num_per_bucket; i++) {
-            int64_t id = program_address[cur_bucket * block_num_per_bucket + i];
-            if (id == -1)  
-                numofPrev++;
-        }
+    numofPrev += block_num_per_bucket - popCount(bucket_valid[cur_bucket]);		// free slots down to this bucket
+    if (cur_bucket >= (leaf_count - 1))
         quantity_map[cur_bucket - leaf_count + 1] = numofPrev;
-
-    }
     else {  
-        for (int i = 0; i < block_num_per_bucket; i++) {
-            int64_t id = program_address[cur_bucket * block_num_per_bucket + i];
-            if (id == -1)
-                numofPrev++;
-        }
         refreshQuantityMap(cur_bucket * 2 + 1, numofPrev);
         refreshQuantityMap(cur_bucket * 2 + 2, numofPrev);
     }
@@ -721,11 +1055,19 @@ void PCDORAM::doSomeChange()
     program_address[64] = 55;
     program_address[566] = 44;
     program_address[1522] = 444;
+    rebuildBucketMeta();
 }
 
 int64_t PCDORAM::findTheBestFitPathForEvict(int neededSpace,bool& isLarge)
 {
     refreshQuantityMap(0, 0);  
+    return bestFitLeaf(neededSpace, isLarge);
+}
+
+// best fit over the current quantity_map: an exact match, else the tightest larger path, else the roomiest smaller one
+int64_t PCDORAM::bestFitLeaf(int neededSpace, bool& isLarge)
+{
+    ORAM_PROFILE_SCOPE(find_best_fit_path);
 
     int64_t targetPathForBig = 0; 
     int64_t targetPathForSmall = 0;
@@ -733,21 +1075,28 @@ int64_t PCDORAM::findTheBestFitPathForEvict(int neededSpace,bool& isLarge)
     int64_t minGapForSmall = INT64_MAX;
     isLarge = false;
 
+    int64_t claimed[64] = { 0 };		// slots claimed on the path down to each depth, redone only where leaf i's path leaves leaf i - 1's
     for (int64_t i = 0; i < leaf_count; i++) {
-        if (neededSpace - quantity_map[i] == 0){
+        int64_t free_slots = quantity_map[i];
+        if (!claimed_buckets.empty()) {
+            for (int d = i ? level_count - 1 - lowestBit(i) : 0; d < level_count; d++)
+                claimed[d] = (d ? claimed[d - 1] : 0) + claimed_in_bucket[((i + leaf_count) >> (level_count - 1 - d)) - 1];
+            free_slots -= claimed[level_count - 1];
+        }
+        if (neededSpace - free_slots == 0){
             return i + leaf_count - 1; 
         }
-        if (quantity_map[i] > neededSpace) {
+        if (free_slots > neededSpace) {
             isLarge = true;
-            if ((quantity_map[i] - neededSpace) < minGapForBig) {
+            if ((free_slots - neededSpace) < minGapForBig) {
                 targetPathForBig = i;
-                minGapForBig = quantity_map[i] - neededSpace;
+                minGapForBig = free_slots - neededSpace;
             }
         }
-        if (quantity_map[i] < neededSpace && !isLarge) {
-            if ((neededSpace - quantity_map[i]) < minGapForSmall) {
+        if (free_slots < neededSpace && !isLarge) {
+            if ((neededSpace - free_slots) < minGapForSmall) {
                 targetPathForSmall = i;
-                minGapForSmall = neededSpace - quantity_map[i];
+                minGapForSmall = neededSpace - free_slots;
             }
         }
     }
@@ -790,5 +1139,5 @@ void PCDORAM::setIfLog(bool isLog)
 
 void PCDORAM::resetFreqCnt()
 {
-    freq_cnt.clear();
+    stash.recountFrequencies();
 }
@@ -12,8 +12,24 @@
 #include "include/PathORAM.h"
 using namespace std;
 
-
-PathORAM::PathORAM() { }
+static const int superblock_merge_threshold = 2;		// accesses to one half shortly after the other
+static const int superblock_fetch_threshold = 3;		// co-accesses before a merge may fetch the buddy off its path
+static const int superblock_merge_window = 4;		// "shortly": within this many accesses per block of the merged superblock
+static const int superblock_split_threshold = 4;		// net prefetched blocks evicted unused; the write-back of the merging access often takes one
+
+
+PathORAM::PathORAM() {
+    fixed_seed = false;
+    replay_log = NULL;
+    eviction_mode = evict_read_path;
+    eviction_rate = 1;
+    accesses_since_eviction = 0;
+    eviction_round = 0;
+    prefetch_paths = true;
+    oblivious = ORAM_OBLIVIOUS;
+    superblock_policy = superblock_off;
+    superblock_max_log = 2;
+}
 
 PathORAM::~PathORAM() { }
 
@@ -27,8 +43,7 @@ PathORAM::~PathORAM() { }
 int PathORAM::configParameters(uint64_t ds_s, uint64_t oram_s, int bl_s, int bn_p, int st_s, bool isDebug) {
    	if (ds_s > oram_s)
    		return 0;		
-    cout << "configParameters: " << endl;
-    cout << oram_s << " " << ds_s << endl;
+    ORAM_INFO("configParameters: " << oram_s << " " << ds_s);
     assert(oram_s > ds_s);	
 
     data_set_size = ds_s;
@@ -50,23 +65,25 @@ int PathORAM::configParameters(uint64_t ds_s, uint64_t oram_s, int bl_s, int bn_
 
 
     assert(st_s > block_num_per_bucket * level_count); 
+    assert(block_num_per_bucket <= 64);		// one bit per slot in scanBucket()
+    assert(real_block_count < INT32_MAX && bucket_count < INT32_MAX);		// LocalCacheLine holds both in 32 bits
     stash.setMaxStashSize(st_s);	
 
     stash.setZvalue(block_num_per_bucket);
     stash.setLvalue(level_count);
     stash.setBlockSize(block_size);
 
-    unsigned seed = chrono::system_clock::now().time_since_epoch().count();
+    if (!fixed_seed)
+        seed = chrono::system_clock::now().time_since_epoch().count();
+    if (replay_log)
+        seed = replay_log->traceSeed(seed);
     random_engine.seed(seed);
     uniform_int_distribution<int> distribute_int1(leaf_count - 1, bucket_count - 1);  
     distribute_int = distribute_int1;
 
-    cout << "block_count: " << block_count << endl;
-    cout << "real_block_count: " << real_block_count << endl;
-    cout << "bucket_count: " << bucket_count << endl;
-    cout << "level_count: " << level_count << endl;
-    cout << "leaf_count: " << leaf_count << endl;
-    cout << "actual_ORAM_size: " << actual_ORAM_size << endl;
+    ORAM_INFO("block_count: " << block_count << ", real_block_count: " << real_block_count
+        << ", bucket_count: " << bucket_count << ", level_count: " << level_count
+        << ", leaf_count: " << leaf_count << ", actual_ORAM_size: " << actual_ORAM_size);
 
     return 1;	
 }
@@ -78,22 +95,70 @@ void PathORAM::setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b) {
     write_back_cycles = w_b;
 }
 
+void PathORAM::setSeed(unsigned s) {
+    seed = s;
+    fixed_seed = true;
+}
+
+unsigned PathORAM::getSeed() { return seed; }
+
+void PathORAM::setReplayLog(ReplayLog *log) { replay_log = log; }
+
+void PathORAM::setEvictionMode(int mode, int rate) {
+    assert(mode == evict_read_path || mode == evict_reverse_lex);
+    assert(rate >= 1);
+    eviction_mode = mode;
+    eviction_rate = rate;
+    accesses_since_eviction = 0;
+}
+
+int PathORAM::getEvictionMode() { return eviction_mode; }
+void PathORAM::setPathPrefetch(bool on) { prefetch_paths = on; }
+void PathORAM::setObliviousStash(bool on) { oblivious = on; }
+bool PathORAM::isObliviousStash() { return oblivious; }
+void PathORAM::setIntegrity(int mode, int hash_bytes, int hash_cycles) { integrity.setMode(mode, hash_bytes, hash_cycles); }
+IntegrityTree& PathORAM::getIntegrityTree() { return integrity; }
+
+void PathORAM::setSuperblocks(int policy, int size) {
+    assert(policy == superblock_off || policy == superblock_static || policy == superblock_dynamic);
+    assert(size >= 1 && size <= 64 && (size & (size - 1)) == 0);
+    superblock_policy = policy;
+    superblock_max_log = bitLength(size) - 1;
+}
+
+int PathORAM::getSuperblockPolicy() { return superblock_policy; }
+int PathORAM::getSuperblockSize(int64_t id) { return superblock_policy == superblock_off ? 1 : 1 << superblock_log[id]; }
+int PathORAM::getEvictionRate() { return eviction_rate; }
+
 int PathORAM::generateRandomLeaf() {
-    return (rand() % leaf_count) + bucket_count - leaf_count;
+    return distribute_int(random_engine);
 }
 
 void PathORAM::initialize() {
     present = new bool[real_block_count + 1];		
+    checked_out = new bool[real_block_count + 1];
     position_map = new int64_t[real_block_count + 1];
     program_address = new int64_t[block_count];
-    curPath_buffer = new int64_t[level_count * block_num_per_bucket];
+    bucket_valid = new uint64_t[bucket_count];
+    slot_leaf = new int32_t[block_count];
+    curPath_buffer = new LocalCacheLine[level_count * block_num_per_bucket];
     evict_queue = new int64_t[level_count * block_num_per_bucket];  
+    evict_queue_leaf = new int32_t[level_count * block_num_per_bucket];
     evict_queue_count = new int[level_count];
+    path_buckets = new int64_t[level_count];
+    stash.setOblivious(oblivious);
+    slot_taken.assign(oblivious ? level_count * block_num_per_bucket : 0, 0);
+    evict_bins.reserve(stash.getMaxStashSize() + level_count * block_num_per_bucket);
+    evict_order.reserve(stash.getMaxStashSize() + level_count * block_num_per_bucket);
+    depth_start.assign(level_count, 0);
     block_data = new int64_t[block_count];
-    assert(present && position_map && program_address && curPath_buffer && evict_queue && evict_queue_count);
+    assert(present && checked_out && position_map && program_address && bucket_valid && slot_leaf && curPath_buffer && evict_queue && evict_queue_leaf && evict_queue_count && path_buckets);
 
     memset(present, 0, sizeof(bool) * (real_block_count + 1));		
+    memset(checked_out, 0, sizeof(bool) * (real_block_count + 1));
     memset(program_address, -1, sizeof(int64_t) * block_count);	
+    memset(bucket_valid, 0, sizeof(uint64_t) * bucket_count);
+    memset(slot_leaf, -1, sizeof(int32_t) * block_count);
     memset(block_data, -1, sizeof(int64_t) * block_count);
 
 //	srand((unsigned)time(NULL));
@@ -104,7 +169,19 @@ void PathORAM::initialize() {
         position_map[i] = rand_leaf;
     //	cout << position_map[i] << " --- +++ ";
     }
-    cout << endl;
+    if (superblock_policy != superblock_off) {
+        assert(!oblivious);
+        superblock_log.assign(real_block_count + 1, superblock_policy == superblock_static ? superblock_max_log : 0);
+        superblock_log[real_block_count] = 0;		// the dummy block stays alone
+        prefetched.assign(real_block_count + 1, 0);
+        merge_score.assign(real_block_count + 1, 0);
+        use_score.assign(real_block_count + 1, 0);
+        last_touch.assign(real_block_count + 1, -1);
+        for (int64_t i = 0; i < real_block_count; i++)		// members share the leaf of their superblock's first block
+            position_map[i] = position_map[superblockStart(i)];
+    }
+    if (integrity.isEnabled())
+        integrity.attach(bucket_count, level_count, block_num_per_bucket, block_size, program_address, slot_leaf, block_data, bucket_valid, seed);
 
     resetMetric();
 }
@@ -122,6 +199,14 @@ int64_t PathORAM::getAccessCount() { return access_count; }
 int64_t PathORAM::getDummyAccessCount() { return dummy_access_count; }
 int64_t PathORAM::getMemoryAccessCount() { return memory_access_count[0] + memory_access_count[1]; }
 int64_t PathORAM::getActualAccessCount() { return actual_access_count; }
+int64_t PathORAM::getEvictionCount() { return eviction_count; }
+
+int64_t PathORAM::getSuperblockReadCount() { return superblock_read_count; }
+int64_t PathORAM::getPrefetchCount() { return prefetch_count; }
+int64_t PathORAM::getPrefetchHitCount() { return prefetch_hit_count; }
+int64_t PathORAM::getPrefetchUnusedCount() { return prefetch_unused_count; }
+int64_t PathORAM::getMergeCount() { return merge_count; }
+int64_t PathORAM::getSplitCount() { return split_count; }
 
 
 int64_t PathORAM::getRA_PathReadCount() { return path_read_count[0]; }
@@ -158,11 +243,33 @@ int64_t PathORAM::getAvgHitLatency() { return ceil(hit_latency * 1.0 / access_co
 
 int64_t PathORAM::getAvgReadyLatency() { return ceil(ready_latency * 1.0 / access_count); }
 
+// most cycles one access can take: the requested path, a dynamic superblock's buddy path and a reverse-lex eviction path read, one path written, a whole superblock remapped
+uint64_t PathORAM::getWorstCaseLatency() {
+    int64_t slots = 1ll * level_count * block_num_per_bucket;
+    int paths = 1 + (superblock_policy == superblock_dynamic) + (eviction_mode != evict_read_path);
+    uint64_t read = hit_through_mem_cycles * slots + write_back_cycles * 1ll * level_count;		// fetchFromPath also rewrites the path's bucket metadata
+    int remapped = superblock_policy != superblock_off ? 1 << superblock_max_log : 1;
+    return hit_directly_cycles + paths * read + write_back_cycles * slots + remap_cycles * 1ll * remapped
+         + paths * integrity.pathCyclesBound(hit_through_mem_cycles, write_back_cycles);
+}
+
+Histogram& PathORAM::getLatencyHistogram() { return latency_hist; }
+Histogram& PathORAM::getTrafficHistogram() { return traffic_hist; }
+Histogram& PathORAM::getOccupancyHistogram() { return stash.occupancy_hist; }
+
 void PathORAM::resetMetric() {
     
     access_count = 0;
     actual_access_count = 0;
     dummy_access_count = 0;
+    eviction_count = 0;
+    superblock_read_count = 0;
+    prefetch_count = 0;
+    prefetch_hit_count = 0;
+    prefetch_unused_count = 0;
+    merge_count = 0;
+    split_count = 0;
+    fill(last_touch.begin(), last_touch.end(), -1);		// actual_access_count restarts
 
 	r_d_a_index = 0;
 	for (int i = 0; i < 2; i++) {
@@ -180,6 +287,11 @@ void PathORAM::resetMetric() {
 
     hit_latency = 0;
     ready_latency = 0;
+
+    latency_hist.reset();
+    traffic_hist.reset();
+    stash.occupancy_hist.reset();
+    integrity.resetCounters();
 }
 
 void PathORAM::setDebug(bool debug) { this->debug = debug; }
@@ -195,11 +307,17 @@ void PathORAM::displayPosMap() {
 }
 
 int64_t PathORAM::access(int64_t id, short operation, int64_t data) {
+    ORAM_PROFILE_SCOPE(access);
     if (id < 0)
         id = real_block_count;  // id < 0 : dummy_access
     //assert(id < real_block_count + 1);
-	if (id >= real_block_count + 1)
-		id = rand() % real_block_count;
+	uint64_t latency_before = hit_latency + ready_latency;
+
+	if (id >= real_block_count + 1) {
+		id = random_engine() % real_block_count;
+		if (replay_log)
+			id = replay_log->traceBlock(id, 0, real_block_count - 1);
+	}
     assert(!stash.isFull() || (operation & dummy));  
 
 	r_d_a_index = (operation == dummy) ? 1 : 0;
@@ -211,11 +329,21 @@ int64_t PathORAM::access(int64_t id, short operation, int64_t data) {
 		actual_access_count++;
 
     if (operation & write_back) {		// this block was evicted from LLC, append it to stash without performing the ORAM access
-        assert(!present[id]);      
-        stash.local_cache.push_back(LocalCacheLine(id, position_map));
+        if (present[id]) {		// a second copy would shadow the one in the tree or stash
+            ORAM_WARN("write_back of block " << id << " that the ORAM still holds, ignored");
+            return finishAccess(0, latency_before);
+        }
+        if (oblivious) {
+            ObliviousBlock b = { id, position_map[id], 0 };
+            obliviousInsert(stash.entries.data(), stash.entries.size(), b);
+            stash.entry_count++;
+        }
+        else
+            stash.local_cache.insert(LocalCacheLine(id, position_map[id]));
         present[id] = true;
-        cout << "Block is evicted from LLC." << endl;
-        return 0;		
+        checked_out[id] = false;
+        ORAM_DEBUG(debug, "Block is evicted from LLC.");
+        return finishAccess(0, latency_before);		
     }
 
     resetEvictQueue();
@@ -223,116 +351,362 @@ int64_t PathORAM::access(int64_t id, short operation, int64_t data) {
     int64_t IO_traffic = 0;
     int64_t cur_pos, new_pos;
 
-    srand((unsigned)time(NULL));
     cur_pos = position_map[id];		// gain current leaf that mapped
     do {
         new_pos = distribute_int(random_engine);
     } while (new_pos == cur_pos);
+    if (replay_log)
+        new_pos = replay_log->traceLeaf(new_pos, leaf_count - 1, bucket_count - 1);
+
+    if (oblivious)
+        return finishAccess(obliviousAccess(id, operation, data, cur_pos, new_pos), latency_before);
 
+    bool grouped = superblock_policy != superblock_off && id < real_block_count;
     bool isExist_pre = scanStash(id);
     if (isExist_pre) {		
         hit_latency += hit_directly_cycles;
-        if (debug)
-            cout << "Block that requested has found in the stash. No need to access ORAM." << endl;
-            stash_hit[r_d_a_index]++;
+        ORAM_DEBUG(debug, "Block that requested has found in the stash. No need to access ORAM.");
+        stash_hit[r_d_a_index]++;
+        if (grouped)
+            usePrefetched(id);
     }
     else { 
         memory_access_count[r_d_a_index]++;
-            stash_miss[r_d_a_index]++;
+        stash_miss[r_d_a_index]++;
 
-        if (debug)
-            cout << "Block hasn't be found. Accessing ORAM..." << endl;
+        ORAM_DEBUG(debug, "Block hasn't be found. Accessing ORAM...");
 
         int64_t index = 0;		
-        IO_traffic += readPath(id, cur_pos, index);		
+        if (eviction_mode == evict_read_path)
+            IO_traffic += readPath(id, cur_pos, index);
+        else
+            IO_traffic += fetchFromPath(id, cur_pos, index);
 		path_read_count[r_d_a_index]++;
 
         if (!present[id]) {		
             if (operation & read) {
-                if (debug)
-                    cout << "ERROR! Reading non-existent block..." << endl;
+                ORAM_DEBUG(debug, "ERROR! Reading non-existent block...");
+            } else if (checked_out[id]) {
+                ORAM_DEBUG(debug, "Block is checked out to the LLC, the write goes nowhere...");
             } else if (operation & write) {		
                 present[id] = true;
-                stash.local_cache.push_back(LocalCacheLine(id, position_map));
-                if (debug)
-                    cout << "Creating a new block..." << endl;
+                stash.local_cache.insert(LocalCacheLine(id, position_map[id]));
+                ORAM_DEBUG(debug, "Creating a new block...");
             }
         } else {	// block exists
             if (operation & read) {
-                if (debug)
-                    cout << "Reading the requested block from ORAM tree..." << endl;
+                ORAM_DEBUG(debug, "Reading the requested block from ORAM tree...");
             } else if (operation & write) {		// modify the block data
                 block_data[index] = data;	
-                if (debug)
-                    cout << "Updating the block data..." << endl;
+                ORAM_DEBUG(debug, "Updating the block data...");
             }
         }
     }
    
     stash.updatePeakAndLastOccupancy();		
 
-    remap(id, new_pos);
+    if (grouped && superblock_policy == superblock_dynamic)
+        IO_traffic += mergeSuperblocks(id);
+    if (grouped)
+        remapSuperblock(id, new_pos);
+    else
+        remap(id, new_pos);
+    if ((operation & checkout) && present[id]) {		// the LLC owns the block until it hands it back with write_back
+        stash.local_cache.erase(id);
+        present[id] = false;
+        checked_out[id] = true;
+    }
 
-    pickBlockstoEvict(cur_pos);
-    IO_traffic += writePath(cur_pos);
-	path_write_count[r_d_a_index]++;
+    if (eviction_mode == evict_read_path) {
+        if (!isExist_pre) {		// after a stash hit the path was not read, writing it would overwrite its blocks
+            pickBlockstoEvict(cur_pos);
+            IO_traffic += writePath(cur_pos);
+            path_write_count[r_d_a_index]++;
+        }
+    }
+    else if (++accesses_since_eviction >= eviction_rate) {
+        accesses_since_eviction = 0;
+        IO_traffic += evictPath(reverseLexLeaf(eviction_round++));
+    }
+
+    return finishAccess(IO_traffic, latency_before);
+}
 
+int64_t PathORAM::finishAccess(int64_t IO_traffic, uint64_t latency_before) {
+    IO_traffic += closeIntegrity();
+    latency_hist.record(hit_latency + ready_latency - latency_before);
+    traffic_hist.record(IO_traffic);
+    stash.recordOccupancy();
     return IO_traffic;
 }
 
-int64_t PathORAM::readPath(int64_t interest, int64_t leaf_label, int64_t &index) {
-    if (debug)
-        cout << "Read Phase - interest: " << interest << endl;
-    int64_t bucket_index = leaf_label;
+// authenticates the path before its buckets are read or changed; content_read: the caller reads its blocks anyway
+int64_t PathORAM::openIntegrity(int64_t leaf_label, bool content_read) {
+    if (!integrity.isEnabled() || integrity.getOpenPath() == leaf_label)
+        return 0;
+    int64_t traffic = closeIntegrity();
+    IntegrityTree::Cost c = integrity.open(leaf_label, content_read);
+    if (!integrity.isModeled())
+        return traffic;
+    hit_latency += c.lines * hit_through_mem_cycles + c.hashes * integrity.getHashCycles();
+    return traffic + c.lines;
+}
 
-    for (int i = 0; i < level_count; i++) {		
-        assert(bucket_index || (bucket_index == 0 && i == level_count - 1));
-        for (int j = 0; j < block_num_per_bucket; j++) {
-            int64_t id = program_address[bucket_index * block_num_per_bucket + j];
-            if (id != -1) {  
-				block_read_count[r_d_a_index][0]++;
-                if (debug)
-                    cout << "read in id: " << id << " ";
-                stash.local_cache.push_back(LocalCacheLine(id, position_map));
-                program_address[bucket_index * block_num_per_bucket + j] = -1; 
-			} else
-				block_read_count[r_d_a_index][1]++;
-            if (id == interest)
-                index = bucket_index * block_num_per_bucket + j;
+// rewrites the open path's hashes if it changed
+int64_t PathORAM::closeIntegrity() {
+    if (!integrity.isEnabled())
+        return 0;
+    IntegrityTree::Cost c = integrity.close();
+    if (!integrity.isModeled())
+        return 0;
+    ready_latency += c.lines * write_back_cycles + c.hashes * integrity.getHashCycles();
+    return c.lines;
+}
+
+void PathORAM::prefetch(int64_t id) {
+    if (!prefetch_paths || id < 0 || id > real_block_count)
+        return;
+    pathBuckets(position_map[id], level_count, path_buckets);
+    prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+}
+
+int64_t PathORAM::readPath(int64_t interest, int64_t leaf_label, int64_t &index) {
+    ORAM_PROFILE_SCOPE(read_path);
+    ORAM_DEBUG(debug, "Read Phase - interest: " << interest);
+    int path_real = 0;
+
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, true);
+    integrity.markDirty();
+    for (int i = level_count - 1; i >= 0; i--) {		// leaf to root
+        int64_t bucket_index = path_buckets[i];
+        uint64_t real = bucket_valid[bucket_index];		// empty buckets need no scan
+        int n = popCount(real);
+        block_read_count[r_d_a_index][0] += n;
+        block_read_count[r_d_a_index][1] += block_num_per_bucket - n;
+        if (real) {
+            int64_t *slots = program_address + bucket_index * block_num_per_bucket;
+            int32_t *leaves = slot_leaf + bucket_index * block_num_per_bucket;
+            int hit;
+            scanBucket(slots, block_num_per_bucket, interest, hit);
+            if (hit >= 0)
+                index = bucket_index * block_num_per_bucket + hit;
+            for (uint64_t m = real; m; m &= m - 1)
+                curPath_buffer[path_real++] = LocalCacheLine(slots[lowestBit(m)], leaves[lowestBit(m)]);
+            fill(slots, slots + block_num_per_bucket, -1);
+            bucket_valid[bucket_index] = 0;
         }
-        if (bucket_index == 1)
-            bucket_index = 0;
-        else
-            bucket_index = ceil((bucket_index - 2) * 1.0 / 2);		
+    }
+    if (superblock_policy != superblock_off && interest >= 0 && interest < real_block_count)
+        markPrefetched(interest, path_real);
+    for (int k = 0; k < path_real; k++) {		// stash insertion batched after the scan
+        ORAM_TRACE(debug, "read in id: " << curPath_buffer[k].id);
+        stash.local_cache.insert(curPath_buffer[k]);
     }
     hit_latency += hit_through_mem_cycles * 1ll * level_count * block_num_per_bucket; 
-    return 1ll * level_count * block_num_per_bucket;
+    return traffic + 1ll * level_count * block_num_per_bucket;
 }
 
-bool PathORAM::scanStash(int64_t interest) {	
-    bool isFound = false;
-    for (stash.iter = stash.local_cache.begin(); stash.iter != stash.local_cache.end(); stash.iter++) {
-        if ((stash.iter)->id == interest) {
-            isFound = true;
-            break;
+// reverse-lex mode: scan the whole path but only move the requested block (and the rest of its superblock) to the stash, the rest wait for their eviction
+int64_t PathORAM::fetchFromPath(int64_t interest, int64_t leaf_label, int64_t &index) {
+    ORAM_PROFILE_SCOPE(read_path);
+    int log = superblock_policy != superblock_off && interest < real_block_count ? superblock_log[interest] : 0;
+    int fetched = 0;
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, true);
+    for (int i = level_count - 1; i >= 0; i--) {
+        int64_t bucket_index = path_buckets[i];
+        int n = popCount(bucket_valid[bucket_index]);
+        block_read_count[r_d_a_index][0] += n;
+        block_read_count[r_d_a_index][1] += block_num_per_bucket - n;
+        if (n == 0)
+            continue;
+        int64_t *slots = program_address + bucket_index * block_num_per_bucket;
+        int hit;
+        scanBucket(slots, block_num_per_bucket, interest, hit);
+        if (hit >= 0)
+            index = bucket_index * block_num_per_bucket + hit;
+        uint64_t taken = hit >= 0 ? 1ull << hit : 0;
+        if (log > 0)
+            for (uint64_t m = bucket_valid[bucket_index]; m; m &= m - 1)
+                taken |= (uint64_t)((slots[lowestBit(m)] >> log) == (interest >> log)) << lowestBit(m);
+        for (uint64_t m = taken; m; m &= m - 1) {
+            int j = lowestBit(m);
+            curPath_buffer[fetched++] = LocalCacheLine(slots[j], slot_leaf[bucket_index * block_num_per_bucket + j]);
+            slots[j] = -1;
+        }
+        if (taken) {
+            bucket_valid[bucket_index] &= ~taken;
+            integrity.markDirty();
         }
     }
-    return isFound;
+    if (log > 0)
+        markPrefetched(interest, fetched);
+    for (int k = 0; k < fetched; k++)
+        stash.local_cache.insert(curPath_buffer[k]);
+    hit_latency += hit_through_mem_cycles * 1ll * level_count * block_num_per_bucket;
+    // the taken slots are invalidated in bucket metadata, one line per bucket rewritten on the whole path so which buckets lost a block stays hidden
+    ready_latency += write_back_cycles * 1ll * level_count;
+    return traffic + 1ll * level_count * block_num_per_bucket + level_count;
+}
+
+bool PathORAM::scanStash(int64_t interest) {	
+    ORAM_PROFILE_SCOPE(scan_stash);
+    return stash.local_cache.find(interest) != NULL;
 }
 
 void PathORAM::remap(int64_t interest, int64_t new_leaf) { 
     position_map[interest] = new_leaf;
+    LocalCacheLine* line = stash.local_cache.find(interest);
+    if (line)
+        line->leaf = new_leaf;
     ready_latency += remap_cycles;
 }
 
+int64_t PathORAM::superblockStart(int64_t id) { return id >> superblock_log[id] << superblock_log[id]; }
+
+// blocks of [start, start + size) in the stash, -1 if a present one is not
+int PathORAM::superblockInStash(int64_t start, int64_t size) {
+    int n = 0;
+    for (int64_t id = start; id < min(start + size, real_block_count); id++) {
+        if (stash.local_cache.find(id))
+            n++;
+        else if (present[id])
+            return -1;
+    }
+    return n;
+}
+
+// a superblock keeps one leaf, so it only moves when every present member is in the stash (always the case after a path read)
+void PathORAM::remapSuperblock(int64_t id, int64_t new_leaf) {
+    int64_t start = superblockStart(id), size = 1ll << superblock_log[id];
+    if (superblockInStash(start, size) < 0)
+        return;
+    for (int64_t m = start; m < min(start + size, real_block_count); m++) {
+        if (m == id)
+            continue;
+        position_map[m] = new_leaf;
+        LocalCacheLine* line = stash.local_cache.find(m);
+        if (line)
+            line->leaf = new_leaf;
+    }
+    remap(id, new_leaf);		// one position map update for the whole superblock
+}
+
+// the first `loaded` entries of curPath_buffer were just read; flag the ones that came along with interest
+void PathORAM::markPrefetched(int64_t interest, int loaded) {
+    int log = superblock_log[interest];
+    if (log == 0)
+        return;
+    int n = 0;
+    for (int k = 0; k < loaded; k++) {
+        int64_t id = curPath_buffer[k].id;
+        if (id != interest && (id >> log) == (interest >> log)) {
+            prefetched[id] = 1;
+            n++;
+        }
+    }
+    prefetch_count += n;
+    superblock_read_count += n > 0;
+}
+
+void PathORAM::usePrefetched(int64_t id) {
+    if (!prefetched[id])
+        return;
+    prefetched[id] = 0;
+    prefetch_hit_count++;
+    int8_t& score = use_score[superblockStart(id)];
+    score = min(score + 1, 8);
+}
+
+// a prefetched block leaves the stash unrequested; a dynamic superblock that keeps wasting its prefetches splits in two
+void PathORAM::dropPrefetched(int64_t id) {
+    if (!prefetched[id])
+        return;
+    prefetched[id] = 0;
+    prefetch_unused_count++;
+    int log = superblock_log[id];
+    if (superblock_policy != superblock_dynamic || log == 0)
+        return;
+    int64_t start = superblockStart(id), half = 1ll << (log - 1);
+    if (--use_score[start] > -superblock_split_threshold)
+        return;
+    for (int64_t m = start; m < min(start + 2 * half, real_block_count); m++)		// the halves keep the shared leaf until accessed
+        superblock_log[m] = log - 1;
+    use_score[start] = 0;
+    if (start + half < real_block_count)
+        use_score[start + half] = 0;
+    merge_score[start] = 0;
+    split_count++;
+}
+
+/*
+    Dynamic policy: an access to a superblock shortly after one to its buddy
+    (the other half of the next larger aligned group) counts toward merging the
+    two. The merged superblock is remapped to one leaf right away, so the
+    buddy's blocks still in the tree are first fetched off their path, as in
+    the reverse-lex read.
+*/
+int64_t PathORAM::mergeSuperblocks(int64_t id) {
+    last_touch[id] = actual_access_count;
+    int log = superblock_log[id];
+    if (log >= superblock_max_log)
+        return 0;
+    int64_t size = 1ll << log, group = id >> (log + 1) << (log + 1);
+    int64_t buddy = (id >> log << log) ^ size;
+    if (group + 2 * size > real_block_count || superblock_log[buddy] != log)
+        return 0;
+    bool recent = false;
+    for (int64_t m = buddy; m < buddy + size; m++)
+        recent |= last_touch[m] >= 0 && actual_access_count - last_touch[m] <= superblock_merge_window * 2 * size;
+    int8_t& score = merge_score[group];
+    if (!recent)
+        return 0;
+    score = min(score + 1, 64);
+    if (score < superblock_merge_threshold || superblockInStash(id >> log << log, size) < 0)
+        return 0;
+    bool fetch = superblockInStash(buddy, size) < 0;
+    if (fetch && score < superblock_fetch_threshold)		// a fetch only pays off once the pair keeps coming back
+        return 0;
+    int64_t traffic = 0;
+    if (fetch) {
+        int64_t index = 0;
+        traffic = fetchFromPath(buddy, position_map[buddy], index);
+        path_read_count[r_d_a_index]++;
+    }
+    for (int64_t m = group; m < group + 2 * size; m++)
+        superblock_log[m] = log + 1;
+    score = 0;
+    use_score[group] = 0;
+    merge_count++;
+    return traffic;
+}
+
 void PathORAM::resetEvictQueue() {
     memset(evict_queue, -1, sizeof(int64_t) * level_count * block_num_per_bucket);	
     memset(evict_queue_count, 0, sizeof(int) * level_count);
 }
 
+void PathORAM::rebuildBucketMeta() {
+    for (int64_t b = 0; b < bucket_count; b++) {
+        bucket_valid[b] = 0;
+        for (int j = 0; j < block_num_per_bucket; j++) {
+            int64_t id = program_address[b * block_num_per_bucket + j];
+            bucket_valid[b] |= (uint64_t)(id != -1) << j;
+            slot_leaf[b * block_num_per_bucket + j] = id == -1 ? -1 : position_map[id];
+        }
+    }
+    if (integrity.isEnabled())
+        integrity.rebuild();
+}
+
 int PathORAM::locateTheIntersection(LocalCacheLine block, int64_t cur_pos) {
     assert(block.id >= 0);
-    int64_t block_pos = *(block.position); 
+    int64_t block_pos = block.leaf; 
 
     if (block_pos > cur_pos)		
         swap(block_pos, cur_pos);
@@ -367,53 +741,231 @@ int PathORAM::findSpaceOfBucketOnPath(int cross_point) {
     return -1;
 }
 
+/*
+    Bins the stash by the deepest level each block may occupy on cur_pos, then
+    fills the path leaf to root taking the deepest blocks first, which places
+    as many blocks as any assignment can. O(stash + L * Z).
+*/
 void PathORAM::pickBlockstoEvict(int64_t cur_pos) {
-    int intersection = -1;
-    int deepestNode = -1;
-    stash.iter = stash.local_cache.begin();
-    while (stash.iter != stash.local_cache.end()) {
-        LocalCacheLine block = *stash.iter;
-        intersection = locateTheIntersection(block, cur_pos);
-        deepestNode = findSpaceOfBucketOnPath(intersection);
-        if (deepestNode != -1) {
-            evict_queue[deepestNode * block_num_per_bucket + evict_queue_count[deepestNode]] = block.id;  
-            evict_queue_count[deepestNode]++;
-            stash.iter = stash.local_cache.erase(stash.iter);		
+    ORAM_PROFILE_SCOPE(pick_blocks_to_evict);
+    evict_bins.clear();
+    fill(depth_start.begin(), depth_start.end(), 0);
+    for (int i = 0; i < (int)stash.local_cache.size(); i++) {
+        int depth = deepestSharedLevel(stash.local_cache[i].leaf, cur_pos, leaf_count, level_count);
+        evict_bins.push_back(make_pair(depth, i));
+        depth_start[depth]++;
+    }
+    int start = 0;
+    for (int depth = level_count - 1; depth >= 0; depth--) {		// counting sort, deepest first
+        int n = depth_start[depth];
+        depth_start[depth] = start;
+        start += n;
+    }
+    evict_order.resize(evict_bins.size());
+    for (auto& b : evict_bins)
+        evict_order[depth_start[b.first]++] = b;
+
+    size_t next = 0;
+    for (int level = level_count - 1; level >= 0 && next < evict_order.size(); level--) {
+        while (evict_queue_count[level] < block_num_per_bucket && next < evict_order.size() && evict_order[next].first >= level) {
+            LocalCacheLine& line = stash.local_cache[evict_order[next].second];
+            evict_queue[level * block_num_per_bucket + evict_queue_count[level]] = line.id;
+            evict_queue_leaf[level * block_num_per_bucket + evict_queue_count[level]] = line.leaf;
+            evict_queue_count[level]++;
+            if (superblock_policy != superblock_off)
+                dropPrefetched(line.id);
+            stash.local_cache.mark(evict_order[next].second);
+            next++;
         }
-        else
-            stash.iter++;
     }
+    stash.local_cache.removeMarked();
 }
 
 int64_t PathORAM::writePath(int leaf_label) {
-    int64_t traffic = 0;
-    int64_t bucket_index = leaf_label;
-    for (int i = 0; i < level_count; i++) {		
-        assert(bucket_index || (bucket_index == 0 && i == level_count - 1));
+    ORAM_PROFILE_SCOPE(write_path);
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<1>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, false);		// free after readPath of the same path
+    integrity.markDirty();
+    for (int i = level_count - 1; i >= 0; i--) {		
+        int64_t bucket_index = path_buckets[i];
+        uint64_t valid = 0;
         for (int j = 0; j < block_num_per_bucket; j++) {
             traffic++;
-            int64_t id = evict_queue[(level_count - 1 - i) * block_num_per_bucket + j];		
+            int64_t id = evict_queue[i * block_num_per_bucket + j];		
 			if (id == -1)
 				block_write_count[r_d_a_index][1]++;
 			else 
 				block_write_count[r_d_a_index][0]++;
             
             program_address[bucket_index * block_num_per_bucket + j] = id;
+            slot_leaf[bucket_index * block_num_per_bucket + j] = evict_queue_leaf[i * block_num_per_bucket + j];
+            valid |= (uint64_t)(id != -1) << j;
         }
-        if (bucket_index == 1)
-            bucket_index = 0;
-        else
-            bucket_index = ceil((bucket_index - 2) * 1.0 / 2);		
+        bucket_valid[bucket_index] = valid;
     }
     ready_latency += write_back_cycles * 1ll * level_count * block_num_per_bucket;
     return traffic;
 }
 
+// leaf bucket of the round-th path in reverse-lexicographic order: the leaf offset is round with its bits reversed
+int64_t PathORAM::reverseLexLeaf(int64_t round) {
+    int bits = level_count - 1;
+    int64_t g = round % leaf_count, offset = 0;
+    for (int i = 0; i < bits; i++)
+        offset |= ((g >> i) & 1) << (bits - 1 - i);
+    return leaf_count - 1 + offset;
+}
+
+// read the whole path into the stash, then refill it as deep as possible
+int64_t PathORAM::evictPath(int64_t leaf_label) {
+    int64_t index = 0;
+    int64_t traffic = oblivious ? obliviousReadPath(real_block_count, leaf_label, true, index) : readPath(real_block_count, leaf_label, index);
+    path_read_count[r_d_a_index]++;
+    resetEvictQueue();
+    if (oblivious)
+        obliviousEvict(leaf_label);
+    else
+        pickBlockstoEvict(leaf_label);
+    traffic += writePath(leaf_label);
+    path_write_count[r_d_a_index]++;
+    eviction_count++;
+    return traffic;
+}
+
+/*
+    Oblivious mode: the path is read even on a stash hit, and the lookup, remap
+    and eviction run over every stash entry with the same access pattern
+    whatever the stash holds. The stash occupancy itself still shows through
+    background eviction, as in the regular mode.
+*/
+int64_t PathORAM::obliviousAccess(int64_t id, short operation, int64_t data, int64_t cur_pos, int64_t new_pos) {
+    memory_access_count[r_d_a_index]++;
+    int64_t index = -1;
+    int64_t IO_traffic = obliviousReadPath(id, cur_pos, eviction_mode == evict_read_path, index);
+    path_read_count[r_d_a_index]++;
+
+    bool hit = present[id] & (index < 0);		// counted for the report only
+    stash_hit[r_d_a_index] += hit;
+    stash_miss[r_d_a_index] += !hit;
+
+    bool update = (operation & write) != 0;
+    for (int i = 0; i < level_count; i++) {		// touch every payload on the path, update the requested one
+        for (int j = 0; j < block_num_per_bucket; j++) {
+            int64_t slot = path_buckets[i] * block_num_per_bucket + j;
+            block_data[slot] = oselect(update & (slot == index), data, block_data[slot]);
+        }
+    }
+
+    // a newly written block takes the spare last entry, empty unless fetchFromPath-style reading put the block there
+    vector<ObliviousBlock>& e = stash.entries;
+    bool create = !present[id] & !checked_out[id] & update;
+    e.back().id = oselect(create, id, e.back().id);
+    stash.entry_count += create;
+    present[id] |= create;
+    bool out = ((operation & checkout) != 0) & present[id];
+    for (size_t k = 0; k < e.size(); k++) {		// lookup, remap and checkout in one pass
+        bool match = e[k].id == id;
+        e[k].leaf = oselect(match, new_pos, e[k].leaf);
+        e[k].id = oselect(match & out, -1, e[k].id);
+    }
+    stash.entry_count -= out;
+    present[id] &= !out;
+    checked_out[id] |= out;
+
+    stash.updatePeakAndLastOccupancy();
+    remap(id, new_pos);
+
+    if (eviction_mode == evict_read_path) {
+        obliviousEvict(cur_pos);
+        IO_traffic += writePath(cur_pos);
+        path_write_count[r_d_a_index]++;
+    }
+    else if (++accesses_since_eviction >= eviction_rate) {
+        accesses_since_eviction = 0;
+        IO_traffic += evictPath(reverseLexLeaf(eviction_round++));
+    }
+    else
+        obliviousInsert(e.data(), e.size() - 1, e.back());		// free the spare entry for the next access
+    return IO_traffic;
+}
+
+/*
+    Copies every slot of the path into the path entries at the end of the
+    stash (whole_path), or, in reverse-lex mode, moves only the requested block
+    into the spare entry. Either way every slot is read and written.
+*/
+int64_t PathORAM::obliviousReadPath(int64_t interest, int64_t leaf_label, bool whole_path, int64_t &index) {
+    ORAM_PROFILE_SCOPE(read_path);
+    vector<ObliviousBlock>& e = stash.entries;
+    int path_slots = level_count * block_num_per_bucket;
+    assert(stash.entry_count <= (int)e.size() - 1 - path_slots);
+    ObliviousBlock* path = &e[e.size() - 1 - path_slots];
+    ObliviousBlock& spare = e.back();
+
+    pathBuckets(leaf_label, level_count, path_buckets);
+    if (prefetch_paths)
+        prefetchPath<0>(program_address, path_buckets, level_count, block_num_per_bucket);
+    int64_t traffic = openIntegrity(leaf_label, true);
+    integrity.markDirty();
+    int loaded = 0, k = 0;
+    for (int i = level_count - 1; i >= 0; i--) {		// leaf to root, as readPath
+        int64_t *slots = program_address + path_buckets[i] * block_num_per_bucket;
+        int32_t *leaves = slot_leaf + path_buckets[i] * block_num_per_bucket;
+        uint64_t& valid = bucket_valid[path_buckets[i]];
+        for (int j = 0; j < block_num_per_bucket; j++, k++) {
+            int64_t id = slots[j];
+            bool real = id != -1, match = id == interest;
+            block_read_count[r_d_a_index][0] += real;
+            block_read_count[r_d_a_index][1] += !real;
+            index = oselect(match, path_buckets[i] * block_num_per_bucket + j, index);
+            if (whole_path) {
+                path[k].id = id;
+                path[k].leaf = leaves[j];
+                slots[j] = -1;
+                loaded += real;
+            }
+            else {
+                spare.id = oselect(match, id, spare.id);
+                slots[j] = oselect(match, -1, id);
+                valid &= ~((uint64_t)match << j);
+                loaded += match;
+            }
+        }
+        valid = oselect(whole_path, 0, valid);
+    }
+    stash.entry_count += loaded;
+    hit_latency += hit_through_mem_cycles * 1ll * path_slots;
+    return traffic + path_slots;
+}
+
+// every slot of the path was read, so all of them are free
+void PathORAM::obliviousEvict(int64_t cur_pos) {
+    ORAM_PROFILE_SCOPE(pick_blocks_to_evict);
+    assert(level_count <= 64);
+    int64_t free[64];
+    fill(free, free + level_count, (int64_t)block_num_per_bucket);
+    stash.entry_count -= obliviousEvictPath(stash.entries.data(), stash.entries.size(), cur_pos, leaf_count, level_count, block_num_per_bucket,
+                                            free, KeepReal(), slot_taken.data(), evict_queue, evict_queue_leaf);
+}
+
 int64_t PathORAM::backgroundEviction() {
     int64_t traffic = 0;
+    if (eviction_mode == evict_reverse_lex) {
+        while (stash.isAlmostFull()) {
+            ORAM_DEBUG(debug, "Background eviction along reverse-lex path " << eviction_round << "...");
+            uint64_t latency_before = hit_latency + ready_latency;
+            r_d_a_index = 1;
+            access_count++;
+            dummy_access_count++;
+            memory_access_count[1]++;
+            traffic += finishAccess(evictPath(reverseLexLeaf(eviction_round++)), latency_before);
+        }
+        return traffic;
+    }
     while (stash.isAlmostFull()) {
-        if (debug)
-            cout << "Background eviction..." << endl;
+        ORAM_DEBUG(debug, "Background eviction...");
         traffic += access(real_block_count, PathORAM::dummy, -1);
     }
     return traffic;
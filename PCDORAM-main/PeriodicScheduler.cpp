@@ -0,0 +1,76 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cassert>
+#include "include/PeriodicScheduler.h"
+using namespace std;
+
+PeriodicScheduler::PeriodicScheduler(uint64_t i) {
+    interval = i;
+    first_epoch = 1 << 20;
+    slot_service = 0;
+}
+
+void PeriodicScheduler::setInterval(uint64_t i) {
+    interval = i;
+    rates.clear();
+}
+
+void PeriodicScheduler::setAdaptive(const vector<uint64_t>& candidates, uint64_t first_epoch_cycles) {
+    assert(!candidates.empty() && first_epoch_cycles > 0);
+    rates = candidates;
+    sort(rates.begin(), rates.end());
+    first_epoch = first_epoch_cycles;
+}
+
+uint64_t PeriodicScheduler::getInterval() { return interval; }
+void PeriodicScheduler::setSlotService(uint64_t cycles) { slot_service = cycles; }
+
+void PeriodicScheduler::submit(uint64_t arrival, int64_t id, short operation) {
+    assert(requests.empty() || arrival >= requests.back().arrival);       // in arrival order
+    Request r = { arrival, id, operation };
+    requests.push_back(r);
+}
+
+void PeriodicScheduler::clear() { requests.clear(); }
+int64_t PeriodicScheduler::getRequestCount() { return requests.size(); }
+
+void PeriodicScheduler::resetStats(Stats& s) {
+    s.real_count = 0;
+    s.dummy_count = 0;
+    s.overrun_count = 0;
+    s.makespan = 0;
+    s.traffic = 0;
+    s.rate_changes = 0;
+    s.response_hist.reset();
+}
+
+// smallest candidate whose slot (service budget + interval) still covers the observed inter-arrival gap
+uint64_t PeriodicScheduler::chooseInterval(int64_t arrivals, uint64_t epoch_length, uint64_t service) {
+    if (arrivals == 0)
+        return rates.back();
+    uint64_t gap = epoch_length / arrivals;
+    for (uint64_t r : rates)
+        if (r + service >= gap)
+            return r;
+    return rates.back();
+}
+
+void PeriodicScheduler::report(ostream& os, Stats& periodic, Stats& on_demand) {
+    os << left << setw(12) << "policy" << right << setw(10) << "real" << setw(10) << "dummy" << setw(16) << "makespan"
+       << setw(14) << "traffic" << setw(14) << "mean resp" << setw(12) << "p99 resp" << endl;
+    Stats* rows[2] = { &on_demand, &periodic };
+    const char* names[2] = { "on-demand", "periodic" };
+    for (int i = 0; i < 2; i++) {
+        Stats& s = *rows[i];
+        os << left << setw(12) << names[i] << right << setw(10) << s.real_count << setw(10) << s.dummy_count
+           << setw(16) << s.makespan << setw(14) << s.traffic << setw(14) << fixed << setprecision(1)
+           << s.response_hist.getMean() << setw(12) << s.response_hist.percentile(99) << endl;
+    }
+    double lost = periodic.makespan ? 1.0 - (double)on_demand.makespan / periodic.makespan : 0.0;
+    os << "throughput lost to timing protection: " << fixed << setprecision(1) << lost * 100 << "%, "
+       << "dummy share of periodic accesses: "
+       << periodic.dummy_count * 100.0 / max(periodic.real_count + periodic.dummy_count, (int64_t)1) << "%, "
+       << "overrun slots: " << periodic.overrun_count << ", "
+       << "rate changes: " << periodic.rate_changes << endl;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include "include/Profiler.h"
+using namespace std;
+
+static mutex registry_mutex;
+static vector<Profiler::Counters*> registry;     // never shrinks, so counters outlive their threads
+
+Profiler::Counters& Profiler::local() {
+    static thread_local Counters* counters = NULL;
+    if (!counters) {
+        counters = new Counters;
+        for (int i = 0; i < phase_count; i++) {
+            counters->cycles[i].store(0, memory_order_relaxed);
+            counters->calls[i].store(0, memory_order_relaxed);
+        }
+        lock_guard<mutex> guard(registry_mutex);
+        registry.push_back(counters);
+    }
+    return *counters;
+}
+
+void Profiler::aggregate(uint64_t* cycles, uint64_t* calls) {
+    for (int i = 0; i < phase_count; i++) {
+        cycles[i] = 0;
+        calls[i] = 0;
+    }
+    lock_guard<mutex> guard(registry_mutex);
+    for (Counters* c : registry) {
+        for (int i = 0; i < phase_count; i++) {
+            cycles[i] += c->cycles[i].load(memory_order_relaxed);
+            calls[i] += c->calls[i].load(memory_order_relaxed);
+        }
+    }
+}
+
+void Profiler::reset() {
+    lock_guard<mutex> guard(registry_mutex);
+    for (Counters* c : registry) {
+        for (int i = 0; i < phase_count; i++) {
+            c->cycles[i].store(0, memory_order_relaxed);
+            c->calls[i].store(0, memory_order_relaxed);
+        }
+    }
+}
+
+// phases nest (e.g. find_best_fit_path inside hybrid_block_kick_out), so times are inclusive
+void Profiler::report(ostream& os) {
+    uint64_t cycles[phase_count];
+    uint64_t calls[phase_count];
+    aggregate(cycles, calls);
+
+    os << left << setw(28) << "phase" << right << setw(14) << "calls" << setw(18) << "cycles"
+       << setw(14) << "cycles/call" << setw(10) << "% access" << endl;
+    for (int i = 0; i < phase_count; i++) {
+        double per_call = calls[i] ? cycles[i] * 1.0 / calls[i] : 0.0;
+        double share = cycles[access] ? cycles[i] * 100.0 / cycles[access] : 0.0;
+        os << left << setw(28) << phaseName(i) << right << setw(14) << calls[i] << setw(18) << cycles[i]
+           << setw(14) << fixed << setprecision(1) << per_call << setw(10) << share << endl;
+    }
+#if !ORAM_PROFILE
+    os << "(built without ORAM_PROFILE, counters are empty)" << endl;
+#endif
+}
+
+const char* Profiler::phaseName(int phase) {
+    switch (phase) {
+    case access: return "access";
+    case scan_stash: return "scanStash";
+    case read_path: return "readPath";
+    case pick_blocks_to_evict: return "pickBlockstoEvict";
+    case write_path: return "writePath";
+    case hybrid_block_merge: return "hybridBlockMerge";
+    case hybrid_block_kick_out: return "hybridBlockKickOut";
+    case find_best_fit_path: return "findTheBestFitPathForEvict";
+    default: return "?";
+    }
+}
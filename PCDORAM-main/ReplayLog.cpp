@@ -0,0 +1,119 @@
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstring>
+#include "include/ReplayLog.h"
+using namespace std;
+
+static const char replay_magic[4] = { 'O', 'R', 'P', 'L' };
+
+ReplayLog::ReplayLog() {
+    mode = off;
+    record_count = 0;
+    diverged = false;
+}
+
+ReplayLog::~ReplayLog() {
+    close();
+}
+
+bool ReplayLog::open(const string& file_name, Mode m) {
+    close();
+    if (m == off)
+        return true;
+
+    char magic[4];
+    if (m == record) {
+        file.open(file_name.c_str(), ios::out | ios::binary | ios::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(replay_magic, sizeof(replay_magic));
+    }
+    else {
+        file.open(file_name.c_str(), ios::in | ios::binary);
+        if (!file.is_open())
+            return false;
+        file.read(magic, sizeof(magic));
+        if (!file || memcmp(magic, replay_magic, sizeof(magic)) != 0) {
+            cerr << "ReplayLog: " << file_name << " is not a replay log." << endl;
+            file.close();
+            return false;
+        }
+    }
+
+    mode = m;
+    record_count = 0;
+    diverged = false;
+    return true;
+}
+
+void ReplayLog::close() {
+    if (file.is_open()) {
+        file.flush();
+        file.close();
+    }
+    mode = off;
+}
+
+void ReplayLog::put(uint8_t tag, uint64_t value) {
+    char buf[11];
+    int len = 0;
+    buf[len++] = tag;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        buf[len++] = byte;
+    } while (value);
+    file.write(buf, len);
+    record_count++;
+}
+
+bool ReplayLog::get(uint8_t tag, uint64_t& value) {
+    int c = file.get();
+    if (c == EOF || (uint8_t)c != tag)
+        return false;
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        c = file.get();
+        if (c == EOF)
+            return false;
+        value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            record_count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// record: append value; replay: return the recorded value, or keep the fresh one once diverged
+uint64_t ReplayLog::trace(uint8_t tag, uint64_t value, uint64_t lo, uint64_t hi) {
+    if (mode == record) {
+        put(tag, value);
+    }
+    else if (mode == replay && !diverged) {
+        uint64_t recorded;
+        bool found = get(tag, recorded);
+        if (found && recorded >= lo && recorded <= hi)
+            return recorded;
+        diverged = true;
+        cerr << "ReplayLog: run diverged from the log after " << record_count << " records";
+        if (found)
+            cerr << " (recorded value " << recorded << " outside [" << lo << ", " << hi << "])";
+        cerr << "." << endl;
+    }
+    return value;
+}
+
+unsigned ReplayLog::traceSeed(unsigned seed) { return (unsigned)trace(seed_tag, seed, 0, UINT32_MAX); }
+int64_t ReplayLog::traceLeaf(int64_t leaf, int64_t lo, int64_t hi) { return (int64_t)trace(leaf_tag, leaf, lo, hi); }
+int64_t ReplayLog::traceEvict(int64_t choice, int64_t lo, int64_t hi) { return (int64_t)trace(evict_tag, choice, lo, hi); }
+int64_t ReplayLog::traceBlock(int64_t id, int64_t lo, int64_t hi) { return (int64_t)trace(block_tag, id, lo, hi); }
+
+ReplayLog::Mode ReplayLog::getMode() { return mode; }
+bool ReplayLog::isRecording() { return mode == record; }
+bool ReplayLog::isReplaying() { return mode == replay; }
+bool ReplayLog::isDiverged() { return diverged; }
+int64_t ReplayLog::getRecordCount() { return record_count; }
@@ -5,18 +5,24 @@ Stash::Stash() {
     peak_occupancy = 0;
     last_occupancy = 0;
     limit_factor = 0.7;
+    oblivious = false;
+    entry_count = 0;
 }
 
 Stash::~Stash() {}
 
 void Stash::updatePeakAndLastOccupancy() {
-    last_occupancy = local_cache.size();
+    last_occupancy = getCurrentStashSize();
     peak_occupancy = (last_occupancy > peak_occupancy) ? last_occupancy : peak_occupancy;
 }
 
+void Stash::recordOccupancy() {
+    occupancy_hist.record(getCurrentStashSize());
+}
+
 bool Stash::isFull(int margin) {
     int upper_limit = max_stash_size - margin - Z_value * L_value;
-    if (local_cache.size() >= upper_limit)
+    if (getCurrentStashSize() >= upper_limit)
         return true;
     return false;
 }
@@ -24,25 +30,37 @@ bool Stash::isFull(int margin) {
 
 bool Stash::isAlmostFull() {
     int upper_limit = max_stash_size - Z_value * L_value;
-    if (local_cache.size() >= limit_factor * upper_limit)
+    if (getCurrentStashSize() >= limit_factor * upper_limit)
         return true;
     return false;
 }
 
 void Stash::displayStash() {
+    for (int i = 0; oblivious && i < entry_count; i++)
+        cout << "(" << entries[i].id << ", " << entries[i].leaf << "), ";
     for (iter = local_cache.begin(); iter != local_cache.end(); iter++)
-        cout << "(" << iter->id << ", " << *(iter->position) << "), ";
+        cout << "(" << iter->id << ", " << iter->leaf << "), ";
     cout << endl;
 }
 
 // setter func()
-void Stash::setMaxStashSize(int size) { max_stash_size = size; }
+void Stash::setMaxStashSize(int size) {
+    max_stash_size = size;
+    local_cache.reserve(size);
+}
 void Stash::setZvalue(int z) { Z_value = z; }
 void Stash::setLvalue(int l) { L_value = l; }
 void Stash::setBlockSize(int bs) { block_size = bs; }
 
+void Stash::setOblivious(bool on) {
+    oblivious = on;
+    ObliviousBlock empty = { -1, 0, 0 };
+    entries.assign(on ? max_stash_size + 1 : 0, empty);
+    entry_count = 0;
+}
+
 // getter func()
 int Stash::getMaxStashSize() { return max_stash_size; }
 int Stash::getPeakOccupancy() { return peak_occupancy; }
 int Stash::getLastOccupancy() { return last_occupancy; }
-int Stash::getCurrentStashSize() { return local_cache.size(); }
\ No newline at end of file
+int Stash::getCurrentStashSize() { return oblivious ? entry_count : local_cache.size(); }
\ No newline at end of file
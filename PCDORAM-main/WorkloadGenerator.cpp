@@ -0,0 +1,171 @@
+#include <cmath>
+#include <cassert>
+#include "include/WorkloadGenerator.h"
+#include "include/PathORAM.h"
+using namespace std;
+
+static const int64_t exact_zeta_terms = 1 << 20;
+static const size_t max_checked_out = 4096;     // later reads leave their block in the ORAM
+
+WorkloadGenerator::WorkloadGenerator(Pattern p, int64_t blocks, unsigned seed)
+    : pattern(p), block_count(blocks), issued(0), rng(seed), unit(0.0, 1.0) {
+    assert(block_count > 0);
+    theta = 0.99;
+    scramble = true;
+    stride = 16;
+    hot_fraction = 0.1;
+    hot_probability = 0.9;
+    phase_length = 100000;
+    setOperationMix(1.0, 0.0, 0.0);
+    if (pattern == zipfian)
+        prepareZipfian();
+}
+
+// exact for the first 2^20 terms, Euler-Maclaurin estimate of the tail beyond
+double WorkloadGenerator::zeta(int64_t n, double theta) {
+    int64_t m = min(n, exact_zeta_terms);
+    double sum = 0.0;
+    for (int64_t i = 1; i <= m; i++)
+        sum += 1.0 / pow((double)i, theta);
+    if (n > m) {
+        sum += (pow((double)n, 1.0 - theta) - pow((double)m, 1.0 - theta)) / (1.0 - theta);
+        sum += (pow((double)n, -theta) - pow((double)m, -theta)) / 2.0;
+    }
+    return sum;
+}
+
+void WorkloadGenerator::prepareZipfian() {
+    zeta_n = zeta(block_count, theta);
+    zeta_2 = zeta(2, theta);
+    alpha = 1.0 / (1.0 - theta);
+    eta = (1.0 - pow(2.0 / block_count, 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+}
+
+void WorkloadGenerator::setZipfSkew(double t) {
+    assert(t > 0.0 && t < 1.0);
+    theta = t;
+    if (pattern == zipfian)
+        prepareZipfian();
+}
+
+void WorkloadGenerator::setScramble(bool s) { scramble = s; }
+
+void WorkloadGenerator::setStride(int64_t s) {
+    assert(s > 0);
+    stride = s;
+}
+
+void WorkloadGenerator::setHotCold(double fraction, double probability) {
+    assert(fraction > 0.0 && fraction <= 1.0 && probability >= 0.0 && probability <= 1.0);
+    hot_fraction = fraction;
+    hot_probability = probability;
+}
+
+void WorkloadGenerator::setPhaseLength(int64_t n) {
+    assert(n > 0);
+    phase_length = n;
+}
+
+void WorkloadGenerator::setOperationMix(double read, double write, double write_back) {
+    double total = read + write + write_back;
+    assert(read >= 0 && write >= 0 && write_back >= 0 && total > 0);
+    read_ratio = read / total;
+    write_ratio = (read + write) / total;
+    checked_out.clear();
+    is_checked_out.assign(write_back > 0 ? block_count : 0, false);
+}
+
+WorkloadGenerator::Pattern WorkloadGenerator::getPattern() { return pattern; }
+int64_t WorkloadGenerator::getBlockCount() { return block_count; }
+int64_t WorkloadGenerator::getIssuedCount() { return issued; }
+
+int64_t WorkloadGenerator::nextId() {
+    switch (pattern) {
+    case uniform:
+        return rng() % block_count;
+    case zipfian: {
+        double u = unit(rng);
+        double uz = u * zeta_n;
+        int64_t rank;
+        if (uz < 1.0)
+            rank = 0;
+        else if (uz < 1.0 + pow(0.5, theta))
+            rank = 1;
+        else
+            rank = min((int64_t)(block_count * pow(eta * u - eta + 1.0, alpha)), block_count - 1);
+        if (!scramble)
+            return rank;
+        uint64_t h = 14695981039346656037ull;       // FNV-1a over the rank bytes
+        for (int i = 0; i < 8; i++) {
+            h ^= (rank >> (i * 8)) & 0xff;
+            h *= 1099511628211ull;
+        }
+        return h % block_count;
+    }
+    case sequential:
+        return issued % block_count;
+    case strided:
+        return (int64_t)((issued * (unsigned __int128)stride) % block_count);
+    case hot_cold:
+    case phase_shift: {
+        int64_t hot_size = max((int64_t)(block_count * hot_fraction), (int64_t)1);
+        int64_t base = (pattern == phase_shift) ? (issued / phase_length) * hot_size % block_count : 0;
+        int64_t offset = (unit(rng) < hot_probability) ? rng() % hot_size : rng() % block_count;
+        return (base + offset) % block_count;
+    }
+    }
+    return 0;
+}
+
+short WorkloadGenerator::nextOperation() {
+    double u = unit(rng);
+    if (u < read_ratio)
+        return PathORAM::read;
+    if (u < write_ratio)
+        return PathORAM::write;
+    return PathORAM::write_back;
+}
+
+WorkloadGenerator::Request WorkloadGenerator::next() {
+    Request r;
+    r.operation = nextOperation();
+    if (r.operation == PathORAM::write_back && !checked_out.empty()) {
+        r.id = checked_out.front();
+        checked_out.pop_front();
+        is_checked_out[r.id] = false;
+    }
+    else {
+        r.id = nextId();
+        if (r.operation == PathORAM::write_back)        // nothing to hand back yet
+            r.operation = PathORAM::read;
+        if (r.operation == PathORAM::read && !is_checked_out.empty() && !is_checked_out[r.id] && checked_out.size() < max_checked_out) {
+            r.operation |= PathORAM::checkout;
+            checked_out.push_back(r.id);
+            is_checked_out[r.id] = true;
+        }
+    }
+    issued++;
+    return r;
+}
+
+const char* WorkloadGenerator::patternName(Pattern p) {
+    switch (p) {
+    case uniform: return "uniform";
+    case zipfian: return "zipfian";
+    case sequential: return "sequential";
+    case strided: return "strided";
+    case hot_cold: return "hot-cold";
+    case phase_shift: return "phase-shift";
+    default: return "?";
+    }
+}
+
+bool WorkloadGenerator::parsePattern(const string& name, Pattern& p) {
+    for (int i = uniform; i <= phase_shift; i++) {
+        if (name == patternName((Pattern)i)) {
+            p = (Pattern)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,356 @@
+/*
+    End-to-end comparison of HierarchicalPathORAM and HierachicalPCDORAM, plus a
+    MixedHierarchical (PCDORAM data level, PathORAM position map levels with
+    smaller stashes). All get the same seed and request stream; for every
+    workload the report lists host throughput, modeled cycles/access, bucket
+    traffic/access, the stash peak and the total stash capacity.
+
+    Workloads: WorkloadGenerator streams, one of them sweeping a sixteenth of the
+    blocks over and over, plus any number of recorded traces given
+    with --trace. A trace is a text file with one "<R|W> <block id>" per line; ids
+    are folded into the data ORAM's block range.
+
+    --integrity reruns PathORAM and PCDORAM with the hash tree verified and its
+    traffic and latency modeled (IntegrityTree::verify_and_model), and reports
+    what integrity costs each of them.
+
+    --superblocks k reruns PathORAM with static and with dynamic superblocks of
+    up to k blocks on its data level (PathORAM::setSuperblocks) and reports how
+    many of the prefetched blocks were used.
+
+    --scheduler gap replays every workload with requests arriving gap cycles
+    apart on average (exponential gaps) through PeriodicScheduler, for PathORAM
+    and PCDORAM: served on demand and at a fixed rate with slots sized to each
+    hierarchy's worst-case access, so the report shows what timing protection
+    costs each of them.
+
+    build: g++ -O2 -DNDEBUG -std=c++11 bench/MacroBenchmark.cpp *.cpp -o macro_bench
+    usage: macro_bench [--quick] [--integrity] [--superblocks k] [--scheduler gap] [--trace file]... [--json results.json]
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include "../include/HierarchicalPathORAM.h"
+#include "../include/HierachicalPCDORAM.h"
+#include "../include/MixedHierarchical.h"
+#include "../include/WorkloadGenerator.h"
+#include "../include/PeriodicScheduler.h"
+using namespace std;
+
+struct Workload {
+    string name;
+    vector<WorkloadGenerator::Request> requests;
+};
+
+struct RunResult {
+    string workload;
+    const char* oram;
+    int64_t accesses;
+    double seconds;
+    double cycles_per_access;
+    double traffic_per_access;
+    uint64_t stash_peak;
+    int64_t stash_capacity;
+    int64_t prefetched;         // superblock prefetches on the data level
+    int64_t prefetch_hits;
+};
+
+struct BenchConfig {
+    uint64_t data_size;
+    int block_size;
+    int Z;
+    double utilization;
+    uint32_t max_posmap_size;
+    int stash_size;
+    int posmap_stash_size;      // position map levels of the mixed hierarchy
+    unsigned seed;
+    int integrity;              // IntegrityTree::Mode
+    int superblock_policy;      // PathORAM::SuperblockPolicy, data level of the PathORAM hierarchy only
+    int superblock_size;
+};
+
+static vector<LevelConfig> homogeneousLevels(const BenchConfig& cfg) {
+    return vector<LevelConfig>{ LevelConfig(cfg.utilization, cfg.block_size, cfg.Z, cfg.stash_size) };
+}
+
+// PCDORAM data level, PathORAM position map levels with smaller stashes
+static vector<LevelConfig> mixedLevels(const BenchConfig& cfg) {
+    return vector<LevelConfig>{ LevelConfig(cfg.utilization, cfg.block_size, cfg.Z, cfg.stash_size, LevelConfig::pcd_oram),
+                                LevelConfig(cfg.utilization, cfg.block_size, cfg.Z, cfg.posmap_stash_size, LevelConfig::path_oram) };
+}
+
+// superblocks exist on the PathORAM data level only; other hierarchies run without them
+template <class HierORAM>
+static void setSuperblocks(HierORAM&, const BenchConfig&) { }
+
+static void setSuperblocks(HierarchicalPathORAM& oram, const BenchConfig& cfg) {
+    oram.getLevel(0).setSuperblocks(cfg.superblock_policy, cfg.superblock_size);
+}
+
+template <class HierORAM>
+static void readSuperblockStats(HierORAM&, RunResult& result) {
+    result.prefetched = 0;
+    result.prefetch_hits = 0;
+}
+
+static void readSuperblockStats(HierarchicalPathORAM& oram, RunResult& result) {
+    result.prefetched = oram.getLevel(0).getPrefetchCount();
+    result.prefetch_hits = oram.getLevel(0).getPrefetchHitCount();
+}
+
+template <class HierORAM>
+static void configHierarchy(HierORAM& oram, const BenchConfig& cfg, const vector<LevelConfig>& levels) {
+    oram.setSeed(cfg.seed);
+    oram.configParameters(cfg.data_size, levels, cfg.max_posmap_size, false);
+    oram.setIntegrity(cfg.integrity);
+    setSuperblocks(oram, cfg);
+    oram.setDefaultLatencyParas(1, 100, 3, 50);
+    oram.initialize();
+}
+
+// every block is written once so later reads hit existing data
+template <class HierORAM>
+static void warmUp(HierORAM& oram) {
+    int64_t blocks = oram.getRealBlockCountOfDataORAM();
+    for (int64_t id = 0; id < blocks; id++) {
+        oram.access(id, PathORAM::write, id);
+        oram.backgroundEviction();
+    }
+    oram.resetMetricForHierORAM();
+}
+
+template <class HierORAM>
+static RunResult runWorkload(const char* name, const BenchConfig& cfg, const vector<LevelConfig>& levels, const Workload& workload) {
+    HierORAM oram;
+    configHierarchy(oram, cfg, levels);
+    warmUp(oram);
+
+    uint64_t latency_before = oram.getHitLatency() + oram.getReadyLatency();
+    uint64_t traffic = 0;
+    auto t0 = chrono::steady_clock::now();
+    const vector<WorkloadGenerator::Request>& requests = workload.requests;
+    for (size_t i = 0; i < requests.size(); i++) {
+        const WorkloadGenerator::Request& r = requests[i];
+        if (i + 1 < requests.size())
+            oram.prefetch(requests[i + 1].id);
+        traffic += oram.access(r.id, r.operation, r.id);
+        traffic += oram.backgroundEviction();
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    if (oram.getIntegrityFailureCount())
+        ORAM_WARN(name << " failed " << oram.getIntegrityFailureCount() << " integrity checks on " << workload.name);
+
+    RunResult result;
+    result.workload = workload.name;
+    result.oram = name;
+    result.accesses = workload.requests.size();
+    result.seconds = chrono::duration<double>(t1 - t0).count();
+    result.cycles_per_access = (oram.getHitLatency() + oram.getReadyLatency() - latency_before) * 1.0 / result.accesses;
+    result.traffic_per_access = traffic * 1.0 / result.accesses;
+    result.stash_peak = oram.getStashOccupancyHistogram().getMax();
+    result.stash_capacity = oram.getTotalStashCapacity();
+    readSuperblockStats(oram, result);
+    return result;
+}
+
+// the workload on a warmed-up hierarchy of its own, once on demand and once at a fixed rate
+template <class HierORAM>
+static void runScheduled(const char* name, const BenchConfig& cfg, const vector<LevelConfig>& levels, const Workload& workload, uint64_t gap,
+                         PeriodicScheduler::Stats& periodic, PeriodicScheduler::Stats& on_demand) {
+    PeriodicScheduler scheduler;
+    scheduler.setAdaptive(vector<uint64_t>{ 0, gap / 4, gap }, 1 << 20);
+    mt19937_64 random(cfg.seed);
+    exponential_distribution<double> next_gap(1.0 / gap);
+    double arrival = 0;
+    for (const WorkloadGenerator::Request& r : workload.requests) {
+        scheduler.submit((uint64_t)arrival, r.id, r.operation);
+        arrival += next_gap(random);
+    }
+
+    HierORAM demand_oram, periodic_oram;
+    configHierarchy(demand_oram, cfg, levels);
+    warmUp(demand_oram);
+    on_demand = scheduler.runOnDemand(demand_oram);
+    configHierarchy(periodic_oram, cfg, levels);
+    warmUp(periodic_oram);
+    periodic = scheduler.runPeriodic(periodic_oram);
+
+    cout << name << " on " << workload.name << ", slot budget " << periodic_oram.getWorstCaseLatency() << " cycles:" << endl;
+    PeriodicScheduler::report(cout, periodic, on_demand);
+}
+
+// 75% reads, 25% writes
+static Workload syntheticWorkload(WorkloadGenerator::Pattern pattern, int64_t blocks, int64_t count) {
+    WorkloadGenerator generator(pattern, blocks, 42);
+    generator.setOperationMix(3, 1, 0);
+    generator.setPhaseLength(max(count / 4, (int64_t)1));
+    Workload w;
+    w.name = WorkloadGenerator::patternName(pattern);
+    for (int64_t i = 0; i < count; i++)
+        w.requests.push_back(generator.next());
+    return w;
+}
+
+static bool traceWorkload(const string& file_name, int64_t blocks, Workload& w) {
+    ifstream in(file_name.c_str());
+    if (!in)
+        return false;
+    w.name = file_name;
+    string op;
+    int64_t id;
+    while (in >> op >> id) {
+        short operation = (op == "W" || op == "w") ? (short)PathORAM::write : (short)PathORAM::read;
+        w.requests.push_back({ ((id % blocks) + blocks) % blocks, operation });
+    }
+    return !w.requests.empty();
+}
+
+static void printRow(ostream& os, const RunResult& r) {
+    os << left << setw(24) << r.workload << setw(12) << r.oram << right << setw(10) << r.accesses
+       << setw(14) << fixed << setprecision(0) << r.accesses / r.seconds
+       << setw(14) << setprecision(1) << r.cycles_per_access
+       << setw(14) << r.traffic_per_access << setw(12) << r.stash_peak << setw(12) << r.stash_capacity << endl;
+}
+
+static void writeJSONRow(ostream& os, const RunResult& r, bool last) {
+    os << "  {\"workload\": \"" << r.workload << "\", \"oram\": \"" << r.oram << "\", \"accesses\": " << r.accesses
+       << ", \"accesses_per_second\": " << fixed << setprecision(1) << r.accesses / r.seconds
+       << ", \"cycles_per_access\": " << r.cycles_per_access << ", \"traffic_per_access\": " << r.traffic_per_access
+       << ", \"stash_peak\": " << r.stash_peak << ", \"stash_capacity\": " << r.stash_capacity
+       << ", \"prefetched\": " << r.prefetched << ", \"prefetch_hits\": " << r.prefetch_hits << "}" << (last ? "" : ",") << endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false, integrity = false;
+    int superblock_size = 0;
+    uint64_t scheduler_gap = 0;
+    string json_file;
+    vector<string> trace_files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick"))
+            quick = true;
+        else if (!strcmp(argv[i], "--integrity"))
+            integrity = true;
+        else if (!strcmp(argv[i], "--superblocks") && i + 1 < argc)
+            superblock_size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--scheduler") && i + 1 < argc)
+            scheduler_gap = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_files.push_back(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json_file = argv[++i];
+    }
+
+    Logger::setLevel(Logger::warn);
+    if (superblock_size && (superblock_size < 2 || superblock_size > 64 || (superblock_size & (superblock_size - 1)))) {
+        ORAM_WARN("--superblocks takes a power of two from 2 to 64, ignoring " << superblock_size);
+        superblock_size = 0;
+    }
+
+    BenchConfig cfg;
+    cfg.data_size = quick ? (2 << 20) : (16 << 20);
+    cfg.block_size = 64;
+    cfg.Z = 4;
+    cfg.utilization = 0.5;
+    cfg.max_posmap_size = 32 * 1024;
+    cfg.stash_size = 300;
+    cfg.posmap_stash_size = 150;
+    cfg.seed = 1234;
+    cfg.integrity = IntegrityTree::off;
+    cfg.superblock_policy = PathORAM::superblock_off;
+    cfg.superblock_size = 1;
+    BenchConfig checked = cfg;
+    checked.integrity = IntegrityTree::verify_and_model;
+    BenchConfig static_sb = cfg, dynamic_sb = cfg;
+    static_sb.superblock_policy = PathORAM::superblock_static;
+    dynamic_sb.superblock_policy = PathORAM::superblock_dynamic;
+    static_sb.superblock_size = dynamic_sb.superblock_size = superblock_size;
+    int64_t count = quick ? 20000 : 200000;
+    int64_t blocks = cfg.data_size / cfg.block_size;
+
+    vector<Workload> workloads;
+    WorkloadGenerator::Pattern patterns[] = { WorkloadGenerator::uniform, WorkloadGenerator::zipfian, WorkloadGenerator::sequential,
+                                              WorkloadGenerator::hot_cold, WorkloadGenerator::phase_shift };
+    for (WorkloadGenerator::Pattern p : patterns)
+        workloads.push_back(syntheticWorkload(p, blocks, count));
+    workloads.push_back(syntheticWorkload(WorkloadGenerator::sequential, blocks / 16, count));      // ~10 sweeps, where dynamic superblocks pay off
+    workloads.back().name = "sequential x10";
+    for (const string& file_name : trace_files) {
+        Workload w;
+        if (traceWorkload(file_name, blocks, w))
+            workloads.push_back(w);
+        else
+            ORAM_WARN("Skipping unreadable or empty trace " << file_name);
+    }
+
+    cout << left << setw(24) << "workload" << setw(12) << "oram" << right << setw(10) << "accesses"
+         << setw(14) << "accesses/s" << setw(14) << "cycles/acc" << setw(14) << "traffic/acc" << setw(12) << "stash peak" << setw(12) << "stash cap" << endl;
+    vector<RunResult> results;
+    for (const Workload& w : workloads) {
+        RunResult path = runWorkload<HierarchicalPathORAM>("PathORAM", cfg, homogeneousLevels(cfg), w);
+        RunResult pcd = runWorkload<HierachicalPCDORAM>("PCDORAM", cfg, homogeneousLevels(cfg), w);
+        RunResult mixed = runWorkload<MixedHierarchical>("Mixed", cfg, mixedLevels(cfg), w);
+        printRow(cout, path);
+        printRow(cout, pcd);
+        printRow(cout, mixed);
+        cout << left << setw(36) << "" << "PCDORAM speedup: x" << setprecision(2)
+             << path.cycles_per_access / max(pcd.cycles_per_access, 1e-9) << " modeled, x"
+             << (pcd.accesses / pcd.seconds) / (path.accesses / path.seconds) << " host" << endl;
+        results.push_back(path);
+        results.push_back(pcd);
+        results.push_back(mixed);
+
+        if (superblock_size) {
+            RunResult path_static = runWorkload<HierarchicalPathORAM>("PathORAM+SBs", static_sb, homogeneousLevels(cfg), w);
+            RunResult path_dynamic = runWorkload<HierarchicalPathORAM>("PathORAM+SBd", dynamic_sb, homogeneousLevels(cfg), w);
+            printRow(cout, path_static);
+            printRow(cout, path_dynamic);
+            cout << left << setw(36) << "" << "superblocks: static x" << setprecision(2)
+                 << path_static.traffic_per_access / max(path.traffic_per_access, 1e-9) << " traffic, "
+                 << setprecision(0) << 100.0 * path_static.prefetch_hits / max(path_static.prefetched, (int64_t)1) << "% of prefetches used; dynamic x"
+                 << setprecision(2) << path_dynamic.traffic_per_access / max(path.traffic_per_access, 1e-9) << " traffic, "
+                 << setprecision(0) << 100.0 * path_dynamic.prefetch_hits / max(path_dynamic.prefetched, (int64_t)1) << "% used" << endl;
+            results.push_back(path_static);
+            results.push_back(path_dynamic);
+        }
+        if (scheduler_gap) {
+            PeriodicScheduler::Stats path_periodic, path_demand, pcd_periodic, pcd_demand;
+            runScheduled<HierarchicalPathORAM>("PathORAM", cfg, homogeneousLevels(cfg), w, scheduler_gap, path_periodic, path_demand);
+            runScheduled<HierachicalPCDORAM>("PCDORAM", cfg, homogeneousLevels(cfg), w, scheduler_gap, pcd_periodic, pcd_demand);
+            cout << left << setw(36) << "" << "timing protection: PathORAM x" << setprecision(2)
+                 << path_periodic.makespan * 1.0 / max(path_demand.makespan, (uint64_t)1) << " makespan, PCDORAM x"
+                 << pcd_periodic.makespan * 1.0 / max(pcd_demand.makespan, (uint64_t)1) << "; periodic PCDORAM x"
+                 << pcd_periodic.makespan * 1.0 / max(path_periodic.makespan, (uint64_t)1) << " of PathORAM's makespan" << endl;
+        }
+        if (!integrity)
+            continue;
+
+        RunResult path_checked = runWorkload<HierarchicalPathORAM>("PathORAM+MT", checked, homogeneousLevels(cfg), w);
+        RunResult pcd_checked = runWorkload<HierachicalPCDORAM>("PCDORAM+MT", checked, homogeneousLevels(cfg), w);
+        printRow(cout, path_checked);
+        printRow(cout, pcd_checked);
+        cout << left << setw(36) << "" << "integrity cost: PathORAM x" << setprecision(2)
+             << path_checked.cycles_per_access / max(path.cycles_per_access, 1e-9) << " cycles, x"
+             << path_checked.traffic_per_access / max(path.traffic_per_access, 1e-9) << " traffic; PCDORAM x"
+             << pcd_checked.cycles_per_access / max(pcd.cycles_per_access, 1e-9) << " cycles, x"
+             << pcd_checked.traffic_per_access / max(pcd.traffic_per_access, 1e-9) << " traffic" << endl;
+        results.push_back(path_checked);
+        results.push_back(pcd_checked);
+    }
+
+    if (!json_file.empty()) {
+        ofstream out(json_file.c_str());
+        out << "[" << endl;
+        for (size_t i = 0; i < results.size(); i++)
+            writeJSONRow(out, results[i], i + 1 == results.size());
+        out << "]" << endl;
+    }
+    return 0;
+}
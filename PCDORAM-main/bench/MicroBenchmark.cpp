@@ -0,0 +1,287 @@
+/*
+    Micro-benchmarks for the ORAM kernels: PathORAM readPath / pickBlockstoEvict /
+    writePath, PCDORAM scanStash / hybridBlockKickOut / findTheBestFitPathForEvict
+    and Stash5::putIntoCandidateArea, across tree depths, Z values and stash fills,
+    plus whole PathORAM and PCDORAM accesses with the regular and the oblivious
+    stash (the fill column holds the stash capacity there).
+
+    Fixtures are deterministic: fixed engine seeds, a fixed workload RNG and a
+    tree pre-populated at 50% utilization by placing every block on its path.
+
+    build: g++ -O2 -DNDEBUG -std=c++11 bench/MicroBenchmark.cpp *.cpp -o micro_bench
+           (add -march=native to use the AVX2 / AVX-512 bucket scan)
+    usage: micro_bench [--quick] [--json results.json]
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include "../include/PathORAM.h"
+#include "../include/PCDORAM.h"
+#include "../include/Histogram.h"
+using namespace std;
+
+struct BenchResult {
+    string kernel;
+    int levels;
+    int Z;
+    int64_t stash_fill;
+    Histogram ns;       // nanoseconds per operation
+};
+
+static deque<BenchResult> results;       // deque keeps references from newResult() valid
+static mt19937_64 workload_rng(42);
+
+static inline uint64_t nowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static BenchResult& newResult(const string& kernel, int levels, int Z, int64_t fill) {
+    results.push_back(BenchResult());
+    BenchResult& r = results.back();
+    r.kernel = kernel;
+    r.levels = levels;
+    r.Z = Z;
+    r.stash_fill = fill;
+    return r;
+}
+
+template <class ORAM>
+static void configEngine(ORAM& oram, int levels, int Z, int stash_size) {
+    const int block_size = 64;
+    int64_t oram_size = ((1ll << levels) - 1) * Z * block_size;
+    oram.setSeed(1234);
+    oram.configParameters(oram_size / 2, oram_size, block_size, Z, stash_size, false);
+    oram.setDefaultLatencyParas(1, 100, 3, 50);
+    oram.initialize();
+    assert(oram.getLevelCount() == levels);
+}
+
+// place every real block into the deepest free slot on its path
+template <class ORAM>
+static void placeBlocks(ORAM& oram) {
+    int Z = oram.getBlockNumPerBucket();
+    int L = oram.getLevelCount();
+    for (int64_t id = 0; id < oram.getRealBlockCount(); id++) {
+        int64_t bucket = oram.position_map[id];
+        for (int i = 0; i < L; i++) {
+            int j = 0;
+            while (j < Z && oram.program_address[bucket * Z + j] != -1)
+                j++;
+            if (j < Z) {
+                oram.program_address[bucket * Z + j] = id;
+                oram.present[id] = true;
+                break;
+            }
+            bucket = (bucket - 1) / 2;
+        }
+    }
+    oram.rebuildBucketMeta();
+}
+
+template <class ORAM>
+static int64_t randomLeaf(ORAM& oram) {
+    return oram.getLeafCount() - 1 + (int64_t)(workload_rng() % oram.getLeafCount());
+}
+
+// grow the stash by reading random paths without writing them back
+template <class ORAM>
+static void fillStash(ORAM& oram, int64_t target) {
+    int64_t index = 0;
+    while (oram.stash.getCurrentStashSize() < target)
+        oram.readPath(-2, randomLeaf(oram), index);
+}
+
+static void benchPathORAM(int levels, int Z, int64_t fill, int iterations) {
+    PathORAM oram;
+    configEngine(oram, levels, Z, 1 << 20);
+    placeBlocks(oram);
+    fillStash(oram, fill);
+
+    BenchResult& read = newResult("PathORAM::readPath", levels, Z, fill);
+    BenchResult& pick = newResult("PathORAM::pickBlockstoEvict", levels, Z, fill);
+    BenchResult& write = newResult("PathORAM::writePath", levels, Z, fill);
+    int64_t index = 0;
+    for (int it = 0; it < iterations; it++) {
+        int64_t leaf = randomLeaf(oram);
+        oram.resetEvictQueue();
+        uint64_t t0 = nowNs();
+        oram.readPath(-2, leaf, index);
+        uint64_t t1 = nowNs();
+        oram.pickBlockstoEvict(leaf);
+        uint64_t t2 = nowNs();
+        oram.writePath(leaf);
+        uint64_t t3 = nowNs();
+        read.ns.record(t1 - t0);
+        pick.ns.record(t2 - t1);
+        write.ns.record(t3 - t2);
+        fillStash(oram, fill);      // hold the fill level
+    }
+}
+
+template <class ORAM>
+static void benchAccess(const string& engine, int levels, int Z, int64_t capacity, bool oblivious, int iterations) {
+    ORAM oram;
+    oram.setObliviousStash(oblivious);
+    configEngine(oram, levels, Z, capacity);
+    placeBlocks(oram);
+
+    BenchResult& access = newResult(engine + (oblivious ? "::access (oblivious)" : "::access"), levels, Z, capacity);
+    for (int it = 0; it < iterations; it++) {
+        int64_t id = workload_rng() % oram.getRealBlockCount();
+        uint64_t t0 = nowNs();
+        oram.access(id, ORAM::read, 0);
+        oram.backgroundEviction();
+        access.ns.record(nowNs() - t0);
+    }
+}
+
+static void benchScanStash(int levels, int Z, int64_t fill, int iterations) {
+    PCDORAM oram;
+    configEngine(oram, levels, Z, 1 << 20);
+    placeBlocks(oram);
+    fillStash(oram, fill);
+
+    BenchResult& scan = newResult("PCDORAM::scanStash", levels, Z, fill);
+    const int batch = 32;
+    for (int it = 0; it < iterations; it++) {
+        int64_t ids[batch];
+        for (int b = 0; b < batch; b++)
+            ids[b] = workload_rng() % oram.getRealBlockCount();
+        uint64_t t0 = nowNs();
+        for (int b = 0; b < batch; b++)
+            oram.scanStash(ids[b]);
+        scan.ns.record((nowNs() - t0) / batch);
+    }
+}
+
+static void benchPutIntoCandidateArea(int levels, int Z, int64_t fill, int iterations) {
+    Stash5 stash;
+    vector<int64_t> posmap(2 * fill + Z * levels + 1, 0);
+    int64_t id_range = posmap.size() - 1;
+    for (int64_t id = 0; id < fill; id++)
+        stash.putIntoCandidateArea(LocalCacheLine(id, posmap[id]));
+
+    BenchResult& put = newResult("Stash5::putIntoCandidateArea", levels, Z, fill);
+    const int batch = 32;
+    for (int it = 0; it < iterations; it++) {
+        int64_t ids[batch];
+        for (int b = 0; b < batch; b++)
+            ids[b] = workload_rng() % id_range;
+        uint64_t t0 = nowNs();
+        for (int b = 0; b < batch; b++)
+            stash.putIntoCandidateArea(LocalCacheLine(ids[b], posmap[ids[b]]));
+        put.ns.record((nowNs() - t0) / batch);
+    }
+}
+
+static void benchKickOut(int levels, int Z, int64_t fill, int iterations) {
+    PCDORAM oram;
+    configEngine(oram, levels, Z, 1 << 20);
+    placeBlocks(oram);
+    int64_t candidates = max(fill, (int64_t)levels);
+    fillStash(oram, candidates);
+
+    // move `candidates` blocks from the temporal area into the candidate area with mixed frequencies
+    vector<pair<int64_t, int> > snapshot_candidates;
+    for (auto it = oram.stash.temporal_area.begin(); it != oram.stash.temporal_area.end() && (int64_t)snapshot_candidates.size() < candidates; ++it)
+        snapshot_candidates.push_back(make_pair((int64_t)it->id, 1 + (int)(workload_rng() % 3)));
+    for (auto& c : snapshot_candidates)
+        oram.stash.temporal_area.erase(c.first);
+
+    vector<int64_t> snapshot_address(oram.program_address, oram.program_address + oram.getBlockCount());
+    vector<int64_t> snapshot_posmap(oram.position_map, oram.position_map + oram.getRealBlockCount() + 1);
+
+    BenchResult& best_fit = newResult("PCDORAM::findTheBestFitPathForEvict", levels, Z, candidates);
+    BenchResult& kick = newResult("PCDORAM::hybridBlockKickOut", levels, Z, candidates);
+    for (int it = 0; it < iterations; it++) {
+        memcpy(oram.program_address, snapshot_address.data(), sizeof(int64_t) * snapshot_address.size());
+        memcpy(oram.position_map, snapshot_posmap.data(), sizeof(int64_t) * snapshot_posmap.size());
+        oram.rebuildBucketMeta();
+        for (auto& c : snapshot_candidates)
+            for (int f = 0; f < c.second; f++)
+                oram.stash.putIntoCandidateArea(LocalCacheLine(c.first, oram.position_map[c.first]));
+
+        bool isLarge = false;
+        uint64_t t0 = nowNs();
+        oram.findTheBestFitPathForEvict(Z * levels / 2, isLarge);
+        uint64_t t1 = nowNs();
+        oram.hybridBlockMerge();        // untimed, the kick-out row is the kick-out alone
+        uint64_t t2 = nowNs();
+        oram.hybridBlockKickOut();
+        uint64_t t3 = nowNs();
+        best_fit.ns.record(t1 - t0);
+        kick.ns.record(t3 - t2);
+    }
+}
+
+static void printResults(ostream& os) {
+    os << left << setw(38) << "kernel" << right << setw(4) << "L" << setw(4) << "Z" << setw(8) << "fill"
+       << setw(10) << "samples" << setw(12) << "mean ns" << setw(10) << "p50 ns" << setw(10) << "p99 ns" << endl;
+    for (auto& r : results) {
+        os << left << setw(38) << r.kernel << right << setw(4) << r.levels << setw(4) << r.Z << setw(8) << r.stash_fill
+           << setw(10) << r.ns.getCount() << setw(12) << fixed << setprecision(1) << r.ns.getMean()
+           << setw(10) << r.ns.percentile(50) << setw(10) << r.ns.percentile(99) << endl;
+    }
+}
+
+static void writeJSON(ostream& os) {
+    os << "[" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchResult& r = results[i];
+        os << "  {\"kernel\": \"" << r.kernel << "\", \"levels\": " << r.levels << ", \"Z\": " << r.Z
+           << ", \"stash_fill\": " << r.stash_fill << ", \"samples\": " << r.ns.getCount()
+           << ", \"mean_ns\": " << fixed << setprecision(1) << r.ns.getMean()
+           << ", \"p50_ns\": " << r.ns.percentile(50) << ", \"p99_ns\": " << r.ns.percentile(99)
+           << ", \"max_ns\": " << r.ns.getMax() << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    os << "]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    string json_file;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick"))
+            quick = true;
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json_file = argv[++i];
+    }
+
+    Logger::setLevel(Logger::warn);
+
+    vector<int> depths = quick ? vector<int>{ 10, 14 } : vector<int>{ 10, 14, 18 };
+    vector<int> Zs = quick ? vector<int>{ 4 } : vector<int>{ 2, 4, 8 };
+    vector<int> fill_percent = quick ? vector<int>{ 0, 60 } : vector<int>{ 0, 30, 60 };
+    int path_iterations = quick ? 300 : 2000;
+    int kick_iterations = quick ? 10 : 50;
+
+    for (int L : depths) {
+        for (int Z : Zs) {
+            int64_t capacity = 10 * Z * L;      // modeled stash capacity the fill levels refer to
+            benchAccess<PathORAM>("PathORAM", L, Z, capacity, false, path_iterations);
+            benchAccess<PathORAM>("PathORAM", L, Z, capacity, true, path_iterations);
+            benchAccess<PCDORAM>("PCDORAM", L, Z, capacity, false, path_iterations);
+            benchAccess<PCDORAM>("PCDORAM", L, Z, capacity, true, path_iterations);
+            for (int pct : fill_percent) {
+                int64_t fill = capacity * pct / 100;
+                benchPathORAM(L, Z, fill, path_iterations);
+                benchScanStash(L, Z, fill, path_iterations);
+                benchPutIntoCandidateArea(L, Z, fill, path_iterations);
+                benchKickOut(L, Z, fill, kick_iterations);
+            }
+        }
+    }
+
+    printResults(cout);
+    if (!json_file.empty()) {
+        ofstream out(json_file.c_str());
+        writeJSON(out);
+    }
+    return 0;
+}
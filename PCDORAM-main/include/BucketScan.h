@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "TreeLayout.h"
+using namespace std;
+
+/*
+    Scans the z slot ids of one bucket (z <= 64). Returns the mask of slots
+    holding a real block (id != -1) and sets hit to the slot holding interest,
+    -1 if none. Compares 8 ids per instruction with AVX-512 and 4 with AVX2
+    when the build enables them (-mavx512f / -mavx2 or -march=native); the tail
+    and other targets use the scalar loop.
+*/
+inline uint64_t scanBucket(const int64_t* ids, int z, int64_t interest, int& hit) {
+    uint64_t real = 0, match = 0;
+    int j = 0;
+#if defined(__AVX512F__)
+    const __m512i empty8 = _mm512_set1_epi64(-1), interest8 = _mm512_set1_epi64(interest);
+    for (; j + 8 <= z; j += 8) {
+        __m512i v = _mm512_loadu_si512((const void*)(ids + j));
+        real |= (uint64_t)_mm512_cmpneq_epi64_mask(v, empty8) << j;
+        match |= (uint64_t)_mm512_cmpeq_epi64_mask(v, interest8) << j;
+    }
+#endif
+#if defined(__AVX2__)
+    const __m256i empty4 = _mm256_set1_epi64x(-1), interest4 = _mm256_set1_epi64x(interest);
+    for (; j + 4 <= z; j += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(ids + j));
+        real |= (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, empty4))) & 0xF) << j;
+        match |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, interest4))) << j;
+    }
+#endif
+    for (; j < z; j++) {
+        real |= (uint64_t)(ids[j] != -1) << j;
+        match |= (uint64_t)(ids[j] == interest) << j;
+    }
+    hit = match ? lowestBit(match) : -1;
+    return real;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+/*
+    Bounded pool of leaves whose paths were read but not yet written back
+    (PCDORAM's delayed eviction). Entries live in a ring buffer in age order.
+    Removing one leaves a tombstone (-1) in place, so removal is O(1); the
+    ends are trimmed right away, and the buffer is compacted once tombstones
+    outnumber the entries, which keeps every operation amortized O(1) and
+    random picks by rejection cheap. push drops the oldest path once
+    `capacity` are held. choose() returns the position of the next path to
+    write back under the pool's policy.
+*/
+class EvictPathPool {
+public:
+    enum Policy {
+        random_path,
+        most_recent,
+        least_full      // most free slots on the path
+    };
+
+private:
+    vector<int64_t> leaves;     // 2 * capacity slots, room for as many tombstones as entries
+    size_t capacity;
+    size_t head;        // oldest entry
+    size_t span;        // entries and tombstones from head on
+    size_t count;       // entries
+    int policy;
+    int64_t dropped_count;
+
+    size_t slot(size_t pos) { return (head + pos) % leaves.size(); }
+    void settle();
+
+public:
+    EvictPathPool(size_t capacity = 64, int p = most_recent);
+
+    void configure(size_t capacity, int p);
+    void clear();
+
+    // full pool: the oldest entry is dropped
+    void push(int64_t leaf);
+    // pos counts from the oldest entry, tombstones included: 0 to getSpan() - 1
+    int64_t at(size_t pos);
+    int64_t removeAt(size_t pos);
+    // drop every entry of leaf, e.g. once its free slots have been filled by someone else
+    void remove(int64_t leaf);
+
+    // free_slots(leaf) is only called by least_full
+    template <class Rng, class FreeSlots> size_t choose(Rng& rng, FreeSlots free_slots);
+
+    bool empty();
+    size_t size();
+    size_t getSpan();
+    size_t getCapacity();
+    int getPolicy();
+    int64_t getDroppedCount();
+};
+
+template <class Rng, class FreeSlots>
+size_t EvictPathPool::choose(Rng& rng, FreeSlots free_slots) {
+    switch (policy) {
+    case random_path:
+        for (;;) {      // at least half of the span holds entries
+            size_t pos = rng() % span;
+            if (leaves[slot(pos)] >= 0)
+                return pos;
+        }
+    case least_full: {
+        size_t best = span - 1;
+        int best_free = -1;
+        for (size_t pos = span; pos-- > 0;) {      // newest first, ties keep the most recent
+            if (leaves[slot(pos)] < 0)
+                continue;
+            int f = free_slots(leaves[slot(pos)]);
+            if (f > best_free) {
+                best_free = f;
+                best = pos;
+            }
+        }
+        return best;
+    }
+    default:
+        return span - 1;        // never a tombstone
+    }
+}
@@ -0,0 +1,442 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Logger.h"
+#include "Histogram.h"
+#include "ReplayLog.h"
+using namespace std;
+
+/*
+    Configuration of one recursion level. utilization, block_size,
+    block_num_per_bucket, stash_size and engine are inputs; the remaining
+    fields are derived by configParameters().
+*/
+struct LevelConfig {
+    enum EngineKind {
+        path_oram = 0,
+        pcd_oram = 1
+    };
+
+    double utilization;
+    int block_size;
+    int block_num_per_bucket;
+    int stash_size;
+    int engine;         // EngineKind, only read by MixedHierarchical
+
+    uint64_t data_size;
+    uint64_t bucket_count;
+    uint64_t block_count;
+    uint64_t leaf_count;
+    int level_count;
+    int position_map_scale_factor;      // position map entries of level i-1 packed into one block of level i
+
+    LevelConfig(double util = 0.5, int bl_s = 64, int bn_p = 4, int st_s = 200, int eng = path_oram)
+        : utilization(util), block_size(bl_s), block_num_per_bucket(bn_p), stash_size(st_s), engine(eng),
+          data_size(0), bucket_count(0), block_count(0), leaf_count(0), level_count(0), position_map_scale_factor(1) {}
+};
+
+/*
+    Recursive (hierarchical) ORAM over any engine with the PathORAM / PCDORAM
+    interface. Level 0 is the data ORAM, level i+1 stores the position map of
+    level i, and recursion stops once the last position map fits on chip.
+
+    Engine calls are statically dispatched. Derived may shadow the hooks below:
+        static const char* levelName();
+        Engine* createLevel(int level);
+        void reportLevelHistograms(ostream& os, const string& prefix, Engine& e);
+*/
+template <class Derived, class Engine>
+class HierarchicalBase {
+protected:
+    vector<Engine*> levels;
+    vector<LevelConfig> level_config;
+    vector<int64_t> address;
+    uint64_t final_position_map_size;       // in byte
+    bool debug;
+
+    int64_t access_count;
+    int64_t dummy_access_count;
+
+    unsigned seed;
+    bool fixed_seed;
+    ReplayLog* replay_log;
+
+    Histogram access_latency_hist;      // end-to-end modeled cycles per hierarchical access
+    Histogram access_traffic_hist;
+
+    Derived& derived() { return *static_cast<Derived*>(this); }
+
+    static const char* levelName() { return "level"; }
+    Engine* createLevel(int) { return new Engine; }
+    void reportLevelHistograms(ostream&, const string&, Engine&) {}
+
+    template <class ConfigAt>
+    int buildLevels(uint64_t ds_s, ConfigAt configAt, uint32_t maxPosMap_size, bool isDebug);
+
+    template <class T>
+    T sumLevels(T (Engine::*getter)()) {
+        T sum = 0;
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            sum += (levels[i]->*getter)();
+        return sum;
+    }
+
+    Histogram mergeLevels(Histogram& (Engine::*getter)()) {
+        Histogram merged;
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            merged.merge((levels[i]->*getter)());
+        return merged;
+    }
+
+    uint64_t sumLevelLatency() { return getHitLatency() + getReadyLatency(); }
+
+public:
+    HierarchicalBase() : final_position_map_size(0), debug(false), access_count(0), dummy_access_count(0),
+                         seed(0), fixed_seed(false), replay_log(NULL) {}
+    ~HierarchicalBase() {
+        for (Engine* e : levels)
+            delete e;
+    }
+    // owns its levels, and derived classes may bind references to them
+    HierarchicalBase(const HierarchicalBase&) = delete;
+    HierarchicalBase& operator=(const HierarchicalBase&) = delete;
+
+    // one entry per level; the last entry is repeated for any deeper level
+    int configParameters(uint64_t ds_s, const vector<LevelConfig>& config, uint32_t maxPosMap_size, bool isDebug) {
+        assert(!config.empty());
+        return buildLevels(ds_s, [&](int i) { return config[min(i, (int)config.size() - 1)]; }, maxPosMap_size, isDebug);
+    }
+
+    /*
+        ds_s: data size
+        util: utilization
+        HOram_bl_s: Hierarchical Path ORAM block size
+        HOram_bn_p: Hierarchical Path ORAM block num per bucket
+        maxPosMap_size: the specified on-chip storage
+        st_s: stash size
+    */
+    int configParameters(uint64_t ds_s, const double* util, int* HOram_bl_s, int* HOram_bn_p, uint32_t maxPosMap_size, int st_s, bool isDebug) {
+        return buildLevels(ds_s, [&](int i) { return LevelConfig(util[i], HOram_bl_s[i], HOram_bn_p[i], st_s); }, maxPosMap_size, isDebug);
+    }
+
+    void initialize();
+
+    void setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b) {
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            levels[i]->setDefaultLatencyParas(h_d, h_t_m, r, w_b);
+    }
+
+    // level i is seeded with s + i; both must be called before configParameters()
+    void setSeed(unsigned s) {
+        seed = s;
+        fixed_seed = true;
+    }
+    void setReplayLog(ReplayLog* log) { replay_log = log; }
+
+    int64_t getMergeTimes() { return 0; }
+
+    int getHierarchy() { return levels.size(); }
+    Engine& getLevel(int index) { return *levels[index]; }
+    const LevelConfig& getLevelConfig(int index) { return level_config[index]; }
+    int getBlockSize(int index) { return level_config[index].block_size; }
+    int getBlockNumPerBucket(int index) { return level_config[index].block_num_per_bucket; }
+    int64_t getBlockCount(int index) { return level_config[index].block_count; }
+    int64_t getBucketCount(int index) { return level_config[index].bucket_count; }
+    int64_t getPosMapScaleFactor(int index) { return level_config[index].position_map_scale_factor; }
+    int64_t getLeafCount(int index) { return level_config[index].leaf_count; }
+    int getLevelCount(int index) { return level_config[index].level_count; }
+    uint64_t getFinalPositionMapSize() { return final_position_map_size; }
+    int getMaxStashSize(int index) { return level_config[index].stash_size; }
+
+    // on-chip stash capacity summed over all levels
+    int64_t getTotalStashCapacity() {
+        int64_t blocks = 0;
+        for (const LevelConfig& c : level_config)
+            blocks += c.stash_size;
+        return blocks;
+    }
+    int64_t getTotalStashBytes() {
+        int64_t bytes = 0;
+        for (const LevelConfig& c : level_config)
+            bytes += (int64_t)c.stash_size * c.block_size;
+        return bytes;
+    }
+
+    int64_t getRealBlockCountForHierORAM() { return sumLevels(&Engine::getRealBlockCount); }
+    int getRealBlockCountOfDataORAM() { return levels[0]->getRealBlockCount(); }
+
+    int64_t getStashHitForHierORAM() { return sumLevels(&Engine::getStashHit); }
+    int64_t getStashMissForHierORAM() { return sumLevels(&Engine::getStashMiss); }
+    // blocks currently held by all stashes
+    int64_t getStashSize() {
+        int64_t size = 0;
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            size += levels[i]->stash.getCurrentStashSize();
+        return size;
+    }
+
+    void resetMetricForHierORAM() {
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            levels[i]->resetMetric();
+        access_latency_hist.reset();
+        access_traffic_hist.reset();
+    }
+
+    void setDebug(bool d) {
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            levels[i]->setDebug(d);
+    }
+
+    double feedbackTime() { return sumLevels(&Engine::feedbackTime); }
+
+    int64_t getAccessCount() { return sumLevels(&Engine::getAccessCount); }
+    int64_t getActualAccessCount() { return sumLevels(&Engine::getActualAccessCount); }
+    int64_t getDummyAccessCount() { return sumLevels(&Engine::getDummyAccessCount); }
+    int64_t getMemoryAccessCount() { return sumLevels(&Engine::getMemoryAccessCount); }
+
+    int64_t getAccessCountOfDataORAM() { return levels[0]->getAccessCount(); }
+    int64_t getActualAccessCountOfDataORAM() { return levels[0]->getActualAccessCount(); }
+    int64_t getDummyAccessCountOfDataORAM() { return levels[0]->getDummyAccessCount(); }
+    int64_t getMemoryAccessCountOfDataORAM() { return levels[0]->getMemoryAccessCount(); }
+
+    // RA: real access, DA: dummy access
+    int64_t getRA_MemoryAccessCount() { return sumLevels(&Engine::getRA_MemoryAccessCount); }
+    int64_t getDA_MemoryAccessCount() { return sumLevels(&Engine::getDA_MemoryAccessCount); }
+    int64_t getRA_StashHitCount() { return sumLevels(&Engine::getRA_StashHit); }
+    int64_t getDA_StashHitCount() { return sumLevels(&Engine::getDA_StashHit); }
+    int64_t getRA_MemoryAccessCountOfDataORAM() { return levels[0]->getRA_MemoryAccessCount(); }
+    int64_t getDA_MemoryAccessCountOfDataORAM() { return levels[0]->getDA_MemoryAccessCount(); }
+    int64_t getRA_StashHitCountOfDataORAM() { return levels[0]->getRA_StashHit(); }
+    int64_t getDA_StashHitCountOfDataORAM() { return levels[0]->getDA_StashHit(); }
+
+    int64_t getRA_PathReadCount() { return sumLevels(&Engine::getRA_PathReadCount); }
+    int64_t getDA_PathReadCount() { return sumLevels(&Engine::getDA_PathReadCount); }
+    int64_t getRA_PathWriteCount() { return sumLevels(&Engine::getRA_PathWriteCount); }
+    int64_t getDA_PathWriteCount() { return sumLevels(&Engine::getDA_PathWriteCount); }
+
+    int64_t getRA_RealBlockReadCount() { return sumLevels(&Engine::getRA_RealBlockReadCount); }
+    int64_t getDA_RealBlockReadCount() { return sumLevels(&Engine::getDA_RealBlockReadCount); }
+    int64_t getRA_RealBlockWriteCount() { return sumLevels(&Engine::getRA_RealBlockWriteCount); }
+    int64_t getDA_RealBlockWriteCount() { return sumLevels(&Engine::getDA_RealBlockWriteCount); }
+
+    int64_t getRA_DummyBlockReadCount() { return sumLevels(&Engine::getRA_DummyBlockReadCount); }
+    int64_t getDA_DummyBlockReadCount() { return sumLevels(&Engine::getDA_DummyBlockReadCount); }
+    int64_t getRA_DummyBlockWriteCount() { return sumLevels(&Engine::getRA_DummyBlockWriteCount); }
+    int64_t getDA_DummyBlockWriteCount() { return sumLevels(&Engine::getDA_DummyBlockWriteCount); }
+
+    uint64_t getHitLatency() { return sumLevels(&Engine::getHitLatency); }
+    uint64_t getReadyLatency() { return sumLevels(&Engine::getReadyLatency); }
+    // most cycles one access on every level can take, e.g. the slot budget of a fixed-rate scheduler
+    uint64_t getWorstCaseLatency() { return sumLevels(&Engine::getWorstCaseLatency); }
+    int64_t getAvgHitLatency() { return ceil(getHitLatency() * 1.0 / getAccessCount()); }
+    int64_t getAvgReadyLatency() { return ceil(getReadyLatency() * 1.0 / getAccessCount()); }
+
+    // end-to-end per hierarchical access
+    Histogram& getAccessLatencyHistogram() { return access_latency_hist; }
+    Histogram& getAccessTrafficHistogram() { return access_traffic_hist; }
+    // snapshots merged across all levels
+    Histogram getLevelLatencyHistogram() { return mergeLevels(&Engine::getLatencyHistogram); }
+    Histogram getLevelTrafficHistogram() { return mergeLevels(&Engine::getTrafficHistogram); }
+    Histogram getStashOccupancyHistogram() { return mergeLevels(&Engine::getOccupancyHistogram); }
+    void reportHistograms(ostream& os);
+
+    void displayPosMapOfDataORAM();
+
+    void generateAddress(int64_t addr);
+
+    uint64_t access(int64_t id, short operation, int64_t data);
+
+    // start loading id's path on every level ahead of access(id), e.g. for the next request of a batch
+    void prefetch(int64_t id) {
+        if (id < 0)
+            return;
+        for (int i = 0; i < getHierarchy(); i++) {
+            if (i > 0)
+                id /= level_config[i].position_map_scale_factor;
+            levels[i]->prefetch(id);
+        }
+    }
+
+    void setPathPrefetch(bool on) {
+        for (int i = 0; i < getHierarchy(); i++)
+            levels[i]->setPathPrefetch(on);
+    }
+
+    // IntegrityTree::Mode on every level; between configParameters() and initialize()
+    void setIntegrity(int mode, int hash_bytes = 32, int hash_cycles = 80) {
+        for (int i = 0; i < getHierarchy(); i++)
+            levels[i]->setIntegrity(mode, hash_bytes, hash_cycles);
+    }
+
+    int64_t getIntegrityFailureCount() {
+        int64_t sum = 0;
+        for (int i = 0; i < getHierarchy(); i++)
+            sum += levels[i]->getIntegrityTree().getFailureCount();
+        return sum;
+    }
+
+    bool isLocalcacheFull() {
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            if (levels[i]->stash.isAlmostFull())
+                return true;
+        return false;
+    }
+
+    // one dummy access on every level, e.g. for a fixed-rate scheduler; always touches memory
+    uint64_t dummyAccess() {
+        access_count++;
+        dummy_access_count++;
+        uint64_t traffic = 0;
+        for (int i = getHierarchy() - 1; i >= 0; i--)
+            traffic += levels[i]->access(-1, Engine::dummy, -1);
+        return traffic;
+    }
+
+    uint64_t backgroundEviction() {
+        uint64_t traffic = 0;
+        while (isLocalcacheFull())
+            traffic += access(-1, Engine::dummy, -1);
+        return traffic;
+    }
+};
+
+// a hierarchy of any engine, without engine-specific extras
+template <class Engine>
+class Hierarchical : public HierarchicalBase<Hierarchical<Engine>, Engine> {
+};
+
+template <class Derived, class Engine>
+template <class ConfigAt>
+int HierarchicalBase<Derived, Engine>::buildLevels(uint64_t ds_s, ConfigAt configAt, uint32_t maxPosMap_size, bool isDebug) {
+    assert(levels.empty());         // should not be called twice
+    assert(ds_s > maxPosMap_size);
+
+    uint64_t data_size = ds_s;
+    int scale_factor = 1;
+    final_position_map_size = data_size;
+    for (int i = 0; final_position_map_size > (uint64_t)maxPosMap_size; i++) {     // iterate until fit into the specified on-chip storage
+        LevelConfig c = configAt(i);
+        int next_block_size = configAt(i + 1).block_size;
+        c.data_size = data_size;
+        c.position_map_scale_factor = scale_factor;
+        uint64_t real_block_count = ceil(c.data_size / c.block_size);
+        // actual oram size * utilization = data size
+        c.block_count = ceil(c.data_size / c.utilization / c.block_size);
+        c.bucket_count = c.block_count / c.block_num_per_bucket;
+        c.level_count = ceil(log2(c.bucket_count + 1));
+        c.bucket_count = (1ull << c.level_count) - 1;
+        c.block_count = c.bucket_count * c.block_num_per_bucket;
+        c.leaf_count = (c.bucket_count + 1) / 2;
+        level_config.push_back(c);
+
+        scale_factor = next_block_size * 8 / c.level_count;
+        scale_factor = 1 << (int)log2(scale_factor);
+        data_size = (real_block_count + scale_factor - 1) / scale_factor * next_block_size;
+        uint64_t last_size = final_position_map_size;
+        final_position_map_size = real_block_count * c.level_count / 8;
+        assert(i == 0 || final_position_map_size < last_size);     // recursion must shrink
+    }
+
+    int hierarchy = level_config.size();
+    address.assign(hierarchy, 0);
+    debug = isDebug;
+    for (int i = 0; i < hierarchy; i++) {
+        LevelConfig& c = level_config[i];
+        ORAM_DEBUG(debug, "data size[" << i << "]: " << c.data_size);
+        Engine* e = derived().createLevel(i);
+        if (fixed_seed)
+            e->setSeed(seed + i);
+        e->setReplayLog(replay_log);
+        e->configParameters(c.data_size, c.data_size / c.utilization, c.block_size, c.block_num_per_bucket, c.stash_size, debug);
+        levels.push_back(e);
+    }
+
+    for (int i = 0; i < hierarchy; i++)
+        ORAM_INFO(derived().levelName() << " " << i << "'s block count: " << levels[i]->getBlockCount() << ", " << level_config[i].level_count << " levels, stash size " << level_config[i].stash_size << ".");
+
+    ORAM_INFO("Data size is " << ds_s / 1024.0 / 1024 << " MB, ORAM size is " << ds_s / level_config[0].utilization / 1024.0 / 1024 << " MB.");
+    ORAM_INFO("Total hierarchy is " << hierarchy << ", on-chip position map's size is " << final_position_map_size << " Bytes");
+    ORAM_INFO("Total stash capacity is " << getTotalStashCapacity() << " blocks, " << getTotalStashBytes() << " Bytes");
+
+    return 1;
+}
+
+template <class Derived, class Engine>
+void HierarchicalBase<Derived, Engine>::initialize() {
+    for (int i = 0; i < getHierarchy(); i++) {
+        levels[i]->initialize();
+        ORAM_DEBUG(debug, "block_count[" << i << "]: " << level_config[i].block_count << ", " << derived().levelName() << "[" << i << "]->getBlockCount(): " << levels[i]->getBlockCount());
+        assert((int64_t)level_config[i].block_count == levels[i]->getBlockCount());
+        assert((int64_t)level_config[i].bucket_count == levels[i]->getBucketCount());
+        assert(level_config[i].level_count == levels[i]->getLevelCount());
+    }
+    access_count = 0;
+    dummy_access_count = 0;
+}
+
+template <class Derived, class Engine>
+void HierarchicalBase<Derived, Engine>::reportHistograms(ostream& os) {
+    access_latency_hist.report(os, "access latency (cycles)");
+    access_traffic_hist.report(os, "access traffic (blocks)");
+    for (int i = 0; i < getHierarchy(); i++) {
+        string level = "ORAM " + to_string(i) + " ";
+        levels[i]->getLatencyHistogram().report(os, level + "latency (cycles)");
+        levels[i]->getOccupancyHistogram().report(os, level + "stash occupancy");
+        derived().reportLevelHistograms(os, level, *levels[i]);
+    }
+}
+
+template <class Derived, class Engine>
+void HierarchicalBase<Derived, Engine>::displayPosMapOfDataORAM() {
+    int64_t* posMap = levels[0]->getPositionMap();
+    for (int64_t i = 0; i < levels[0]->getRealBlockCount(); i++)
+        cout << i << "-" << posMap[i] << " ";
+    cout << endl;
+}
+
+template <class Derived, class Engine>
+void HierarchicalBase<Derived, Engine>::generateAddress(int64_t addr) {
+    address[0] = addr;
+    ORAM_DEBUG(debug, "address[0]" << address[0]);
+    for (int i = 1; i < getHierarchy(); i++) {
+        address[i] = address[i - 1] / level_config[i].position_map_scale_factor;
+        ORAM_DEBUG(debug, "address[" << i << "]: " << address[i]);
+        assert(address[i] >= 0);
+    }
+}
+
+template <class Derived, class Engine>
+uint64_t HierarchicalBase<Derived, Engine>::access(int64_t id, short operation, int64_t data) {
+    access_count++;
+    int hierarchy = getHierarchy();
+
+    uint64_t IO_traffic = 0;
+    if (id < 0) {
+        for (int i = hierarchy - 1; i >= 0; i--)
+            IO_traffic += levels[i]->backgroundEviction();
+        return IO_traffic;
+    }
+    for (int i = hierarchy - 1; i >= 0; i--)
+        assert(levels[i] && !levels[i]->stash.isFull());       // check stash not full
+
+    generateAddress(id);
+    uint64_t latency_before = sumLevelLatency();
+    for (int i = hierarchy - 1; i >= 0; i--)        // the levels' paths are independent, overlap their misses
+        levels[i]->prefetch(address[i]);
+
+    for (int i = hierarchy - 1; i > 0; i--) {
+        ORAM_DEBUG(debug, "Begin " << derived().levelName() << " " << i << " access...--- " << address[i]);
+        IO_traffic += levels[i]->access(address[i], Engine::write, -1);
+    }
+    ORAM_DEBUG(debug, "Begin " << derived().levelName() << " 0 access...--- " << address[0]);
+    IO_traffic += levels[0]->access(address[0], operation, data);
+
+    access_latency_hist.record(sumLevelLatency() - latency_before);
+    access_traffic_hist.record(IO_traffic);
+    return IO_traffic;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+/*
+    HDR-style log-linear histogram of non-negative integers.
+    Values below 2^sub_bucket_bits are exact; above that every power of two is
+    split into 2^(sub_bucket_bits-1) buckets, i.e. about 3% relative precision.
+    Histograms of the same layout can be merged, so per-level snapshots of a
+    hierarchical ORAM can be combined.
+*/
+class Histogram {
+private:
+    static const int sub_bucket_bits = 6;
+    static const int sub_bucket_count = 1 << sub_bucket_bits;
+    static const int sub_bucket_half = sub_bucket_count / 2;
+    static const int bucket_count = sub_bucket_count + (64 - sub_bucket_bits) * sub_bucket_half;
+
+    vector<uint64_t> counts;
+    uint64_t total_count;
+    uint64_t min_value;
+    uint64_t max_value;
+    double sum;
+
+    static int indexOf(uint64_t value);
+    static uint64_t highestValueOf(int index);
+
+public:
+    Histogram();
+
+    void record(uint64_t value, uint64_t n = 1);
+    void merge(const Histogram& other);
+    void reset();
+
+    uint64_t getCount() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+    uint64_t percentile(double p) const;     // p in [0, 100]
+
+    // name: count, mean, p50, p99, p99.9, max
+    void report(ostream& os, const string& name) const;
+};
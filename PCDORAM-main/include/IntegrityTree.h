@@ -0,0 +1,141 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+/*
+    Hash tree over the ORAM tree: a bucket's node hash covers its Z slots (id,
+    leaf label and payload of each valid slot) and the node hashes of its two
+    children, and the root's is kept on chip. The engines open a path before
+    they read or change its buckets, which authenticates it against the root,
+    mark it dirty when they change it, and close it at the end of the access,
+    which rewrites the node hashes of the path once however often it changed.
+
+    Node hashes are a keyed 64-bit MAC: NH (as in UMAC) over the slot words,
+    then a multiply-fold with the bucket index and the child hashes. The slot
+    digests of a path do not depend on each other, so they are all computed
+    before the chaining pass, one NH call per bucket over its 4Z words (16
+    words per instruction with AVX-512, 8 with AVX2). The MAC stands in
+    for the real one; its off-chip size and computation time are parameters of
+    the cost model.
+
+    Cost of a path, in memory lines (blocks) and bucket hashes:
+        open:   L - 1 sibling hashes read, L hashes, plus the blocks on the
+                path when the caller has not read them (e.g. before a write)
+        close:  L - 1 node hashes written, L hashes
+*/
+class IntegrityTree {
+public:
+    enum Mode {
+        off,
+        verify,                 // hashes kept and checked, the cost only in the counters below
+        verify_and_model        // the cost also charged to the engine's traffic and latency
+    };
+
+    struct Cost {
+        int64_t lines;
+        int64_t hashes;
+    };
+
+private:
+    int mode;
+    int hash_bytes;         // off-chip size of a node hash
+    int hash_cycles;        // cycles to hash one bucket
+
+    int64_t bucket_count;
+    int level_count;
+    int z;
+    int block_size;
+    const int64_t* ids;
+    const int32_t* leaves;
+    const int64_t* data;
+    const uint64_t* valid;
+
+    vector<uint64_t> node_hash;
+    uint64_t root;          // on chip
+    int64_t open_leaf;      // -1: no path open
+    bool dirty;
+
+    vector<uint32_t> nh_key;        // 4 words per slot
+    uint64_t fold_key[3];
+    vector<uint32_t> message;       // path scratch: 4 words per slot, root bucket first
+    vector<uint64_t> path_hash;
+
+    int64_t verify_count;
+    int64_t update_count;
+    int64_t failure_count;
+    int64_t hash_count;
+    int64_t hash_lines_read;
+    int64_t hash_lines_written;
+    int64_t content_lines_read;
+
+    uint64_t bucketHash(int64_t bucket, uint64_t digest, uint64_t left, uint64_t right);
+    void loadBucket(int64_t bucket, uint32_t* words);
+    uint64_t hashPath(int64_t leaf, bool store);
+    int64_t hashLines(int64_t hashes);
+
+public:
+    IntegrityTree();
+
+    void setMode(int m, int bytes = 32, int cycles = 80);
+    int getMode();
+    bool isEnabled();
+    bool isModeled();
+    int getHashCycles();
+    // most cycles one path can add: opened without its blocks read, then rewritten; 0 unless modeled
+    uint64_t pathCyclesBound(int read_cycles, int write_cycles);
+
+    // the engine's bucket metadata and payloads; hashes the whole tree
+    void attach(int64_t buckets, int levels, int slots_per_bucket, int bl_s,
+                const int64_t* slot_ids, const int32_t* slot_leaves, const int64_t* payloads, const uint64_t* bucket_valid, unsigned seed);
+    // after the engine rewrote its arrays directly
+    void rebuild();
+
+    int64_t getOpenPath();
+    Cost open(int64_t leaf, bool content_read);
+    void markDirty();
+    Cost close();
+
+    void resetCounters();
+    int64_t getVerifyCount();
+    int64_t getUpdateCount();
+    int64_t getFailureCount();
+    int64_t getHashCount();
+    int64_t getHashLinesRead();
+    int64_t getHashLinesWritten();
+    int64_t getContentLinesRead();
+};
+
+// NH over an even number of words: sum of (m[2i] + k[2i]) * (m[2i+1] + k[2i+1]) mod 2^64
+inline uint64_t nhDigest(const uint32_t* m, const uint32_t* k, int words) {
+    uint64_t sum = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i acc8 = _mm256_setzero_si256();
+#endif
+#if defined(__AVX512F__)
+    __m512i acc16 = _mm512_setzero_si512();
+    for (; i + 16 <= words; i += 16) {
+        __m512i x = _mm512_add_epi32(_mm512_loadu_si512((const void*)(m + i)), _mm512_loadu_si512((const void*)(k + i)));
+        acc16 = _mm512_add_epi64(acc16, _mm512_maskz_mul_epu32(0xFF, x, _mm512_maskz_srli_epi64(0xFF, x, 32)));
+    }
+    // halves reduced by the AVX2 tail; the maskz forms avoid GCC 12's false -Wmaybe-uninitialized on the plain ones
+    acc8 = _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xF, acc16, 0), _mm512_maskz_extracti64x4_epi64(0xF, acc16, 1));
+#endif
+#if defined(__AVX2__)
+    for (; i + 8 <= words; i += 8) {
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(m + i)), _mm256_loadu_si256((const __m256i*)(k + i)));
+        acc8 = _mm256_add_epi64(acc8, _mm256_mul_epu32(x, _mm256_srli_epi64(x, 32)));
+    }
+    __m128i acc2 = _mm_add_epi64(_mm256_castsi256_si128(acc8), _mm256_extracti128_si256(acc8, 1));
+    sum += _mm_cvtsi128_si64(acc2) + _mm_extract_epi64(acc2, 1);
+#endif
+    for (; i < words; i += 2)
+        sum += (uint64_t)(uint32_t)(m[i] + k[i]) * (uint32_t)(m[i + 1] + k[i + 1]);
+    return sum;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include "PathORAM.h"
+using namespace std;
+
+/*
+    Set-associative, write-allocate last-level cache with LRU replacement and
+    dirty bits. Lines are ORAM blocks, so the line size is the data ORAM's block
+    size and lines are addressed by block id.
+*/
+class LastLevelCache {
+public:
+    struct Result {
+        bool hit;
+        int64_t victim;         // evicted block id, -1 if nothing was evicted
+        bool victim_dirty;
+    };
+
+private:
+    struct Line {
+        int64_t id;             // -1: invalid
+        bool dirty;
+        uint64_t last_use;
+    };
+
+    int64_t set_count;
+    int associativity;
+    vector<Line> lines;         // set-major, associativity lines per set
+    uint64_t clock;
+
+    int64_t hit_count;
+    int64_t miss_count;
+    int64_t clean_eviction_count;
+    int64_t dirty_eviction_count;
+
+public:
+    LastLevelCache();
+
+    // cache_size and line_size in byte; the set count is rounded down to a power of two
+    void configParameters(uint64_t cache_size, int line_size, int ways);
+
+    Result access(int64_t id, bool isWrite);
+    // hand every valid line to flush(id) and drop it; lines are checked out of the ORAM, clean ones included
+    template <class Flush> void flushAll(Flush flush);
+
+    int64_t getSetCount();
+    int getAssociativity();
+    int64_t getHitCount();
+    int64_t getMissCount();
+    int64_t getCleanEvictionCount();
+    int64_t getDirtyEvictionCount();
+    double getHitRate();
+
+    void resetMetric();
+    void report(ostream& os);
+};
+
+template <class Flush>
+void LastLevelCache::flushAll(Flush flush) {
+    for (Line& l : lines) {
+        if (l.id >= 0) {
+            flush(l.id);
+            if (l.dirty)
+                dirty_eviction_count++;
+            else
+                clean_eviction_count++;
+        }
+        l.id = -1;
+        l.dirty = false;
+    }
+}
+
+/*
+    Puts a LastLevelCache in front of an ORAM (engine or hierarchy). LLC hits
+    never reach the ORAM; a miss checks the block out of the ORAM (read |
+    checkout), so the LLC holds the only copy, and every victim, clean or
+    dirty, is handed back with a write_back first, which the engines take into
+    the stash without a path access. Operations use the engines' shared
+    Operations values. Exposes access(), prefetch() and
+    backgroundEviction(), so WorkloadGenerator::drive() works on it unchanged.
+*/
+template <class ORAM>
+class CachedORAM {
+private:
+    ORAM& oram;
+    LastLevelCache& llc;
+    int64_t oram_read_count;
+    int64_t write_back_count;
+
+public:
+    CachedORAM(ORAM& o, LastLevelCache& c) : oram(o), llc(c), oram_read_count(0), write_back_count(0) {}
+
+    uint64_t access(int64_t id, short operation, int64_t data) {
+        LastLevelCache::Result r = llc.access(id, (operation & PathORAM::write) != 0);
+        if (r.hit)
+            return 0;
+        uint64_t traffic = 0;
+        if (r.victim >= 0) {
+            traffic += oram.access(r.victim, PathORAM::write_back, r.victim);
+            traffic += oram.backgroundEviction();
+            write_back_count++;
+        }
+        traffic += oram.access(id, PathORAM::read | PathORAM::checkout, data);
+        oram_read_count++;
+        return traffic;
+    }
+
+    uint64_t backgroundEviction() { return oram.backgroundEviction(); }
+
+    // wasted on an LLC hit, but the cache is not probed so its LRU state stays untouched
+    void prefetch(int64_t id) { oram.prefetch(id); }
+
+    // hand every line back, e.g. at the end of a run
+    uint64_t flush() {
+        uint64_t traffic = 0;
+        llc.flushAll([&](int64_t id) {
+            traffic += oram.access(id, PathORAM::write_back, id);
+            traffic += oram.backgroundEviction();
+            write_back_count++;
+        });
+        return traffic;
+    }
+
+    ORAM& getORAM() { return oram; }
+    LastLevelCache& getLLC() { return llc; }
+    int64_t getORAMReadCount() { return oram_read_count; }
+    int64_t getWriteBackCount() { return write_back_count; }
+};
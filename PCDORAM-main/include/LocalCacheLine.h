@@ -1,19 +1,26 @@
 #pragma once
 
 #include <iostream>
+#include <cstdint>
 using namespace std;
 
+/*
+    A stash entry. It carries the block's leaf (bucket index, as in the position
+    map) so eviction never looks the block up in the position map; engines keep
+    it in step in remap(). Both fields are 32 bits, configParameters() asserts
+    that block ids and bucket indices fit.
+*/
 class LocalCacheLine
 {
 public:
-    int64_t id;				
-    int64_t* position;		
+    int32_t id;
+    int32_t leaf;
 
 	LocalCacheLine() { }
-	LocalCacheLine(int64_t id, int64_t* posMap)
+	LocalCacheLine(int64_t id, int64_t leaf)
 	{
-		this->id = id;
-		this->position = posMap + id;	
+		this->id = (int32_t)id;
+		this->leaf = (int32_t)leaf;
 	}
 
 	~LocalCacheLine() { }
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+/*
+    Compile-time log levels. Messages below ORAM_LOG_LEVEL are removed by the
+    preprocessor, so release builds (NDEBUG) carry no debug output at all.
+*/
+#define ORAM_LOG_LEVEL_TRACE 0
+#define ORAM_LOG_LEVEL_DEBUG 1
+#define ORAM_LOG_LEVEL_INFO 2
+#define ORAM_LOG_LEVEL_WARN 3
+#define ORAM_LOG_LEVEL_OFF 4
+
+#ifndef ORAM_LOG_LEVEL
+#ifdef NDEBUG
+#define ORAM_LOG_LEVEL ORAM_LOG_LEVEL_INFO
+#else
+#define ORAM_LOG_LEVEL ORAM_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+/*
+    Lock-free ring buffer of trace messages. Producers claim a position with
+    one fetch_add and never block; once full, the oldest entries are
+    overwritten. A slot's seq is 2 * (position + 1) once its entry is complete
+    and odd while a producer writes it, and a producer only takes the slot
+    from an older complete entry, so two writers a lap apart never share it:
+    the one that finds the slot busy or already reused drops its message.
+*/
+class TraceRing {
+public:
+    static const int message_size = 112;
+
+    struct Entry {
+        atomic<uint64_t> seq;       // 2 * (position + 1) once complete, 2 * position + 1 while being written
+        uint64_t timestamp;         // ns since epoch
+        uint32_t thread;
+        uint8_t level;
+        char message[message_size];
+    };
+
+private:
+    Entry* entries;
+    uint64_t capacity;      // power of two
+    atomic<uint64_t> head;
+    atomic<uint64_t> dropped;
+
+public:
+    TraceRing();
+
+    void setCapacity(uint64_t cap);
+    void push(int level, const string& msg);
+    void drain(ostream& os);    // dump the retained entries, oldest first
+    void clear();
+
+    uint64_t getCapacity();
+    uint64_t getPushedCount();
+    uint64_t getDroppedCount();     // messages that lost their slot to a writer a lap ahead or behind
+
+    ~TraceRing();
+};
+
+class Logger {
+public:
+
+    enum Level {
+        trace = ORAM_LOG_LEVEL_TRACE,
+        debug = ORAM_LOG_LEVEL_DEBUG,
+        info = ORAM_LOG_LEVEL_INFO,
+        warn = ORAM_LOG_LEVEL_WARN
+    };
+
+    enum Sink {
+        console = 0,    // cout, serialized
+        ring = 1        // per-process TraceRing, lock-free
+    };
+
+private:
+    static atomic<int> runtime_level;
+    static atomic<int> sink;
+    static TraceRing trace_ring;
+
+public:
+    static bool enabled(int level) { return level >= runtime_level.load(memory_order_relaxed); }
+    static void write(int level, const string& msg);
+
+    static void setLevel(int level);
+    static void setSink(Sink s);
+    static TraceRing& getTraceRing();
+    static const char* levelName(int level);
+};
+
+#define ORAM_LOG(level, expr) \
+    do { \
+        if (Logger::enabled(level)) { \
+            ostringstream oram_log_os; \
+            oram_log_os << expr; \
+            Logger::write(level, oram_log_os.str()); \
+        } \
+    } while (0)
+
+#define ORAM_LOG_NOTHING() do { } while (0)
+
+#if ORAM_LOG_LEVEL <= ORAM_LOG_LEVEL_TRACE
+#define ORAM_TRACE(cond, expr) do { if (cond) ORAM_LOG(Logger::trace, expr); } while (0)
+#else
+#define ORAM_TRACE(cond, expr) ORAM_LOG_NOTHING()
+#endif
+
+// cond is the per-instance runtime debug flag
+#if ORAM_LOG_LEVEL <= ORAM_LOG_LEVEL_DEBUG
+#define ORAM_DEBUG(cond, expr) do { if (cond) ORAM_LOG(Logger::debug, expr); } while (0)
+#else
+#define ORAM_DEBUG(cond, expr) ORAM_LOG_NOTHING()
+#endif
+
+#if ORAM_LOG_LEVEL <= ORAM_LOG_LEVEL_INFO
+#define ORAM_INFO(expr) ORAM_LOG(Logger::info, expr)
+#else
+#define ORAM_INFO(expr) ORAM_LOG_NOTHING()
+#endif
+
+#if ORAM_LOG_LEVEL <= ORAM_LOG_LEVEL_WARN
+#define ORAM_WARN(expr) ORAM_LOG(Logger::warn, expr)
+#else
+#define ORAM_WARN(expr) ORAM_LOG_NOTHING()
+#endif
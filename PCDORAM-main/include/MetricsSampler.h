@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "PathORAM.h"
+#include "PCDORAM.h"
+#include "HierarchicalPathORAM.h"
+#include "HierachicalPCDORAM.h"
+using namespace std;
+
+/*
+    Snapshots every counter of an ORAM every `interval` accesses into a
+    columnar in-memory buffer, exported as CSV or JSON at the end of a run.
+    Call tick() after each access; the column set is fixed by the first sample.
+*/
+class MetricsSampler {
+private:
+    int64_t interval;
+    int64_t tick_count;
+    int64_t row_count;
+    size_t column_cursor;
+    vector<string> column_names;
+    vector<vector<int64_t> > columns;
+
+    void beginRow();
+    void put(const char* name, int64_t value);
+
+    // counters shared by both engines / both hierarchies
+    template <class ORAM> void sampleEngine(ORAM& oram);
+    template <class HierORAM> void sampleHierarchy(HierORAM& oram);
+
+public:
+    MetricsSampler(int64_t n = 1000000);
+
+    void setInterval(int64_t n);
+    int64_t getInterval();
+    int64_t getSampleCount();
+    const vector<string>& getColumnNames();
+    const vector<int64_t>& getColumn(const string& name);
+
+    template <class ORAM>
+    void tick(ORAM& oram) {
+        if (++tick_count % interval == 0)
+            sample(oram);
+    }
+
+    void sample(PathORAM& oram);
+    void sample(PCDORAM& oram);
+    void sample(HierarchicalPathORAM& oram);
+    void sample(HierachicalPCDORAM& oram);
+
+    void exportCSV(ostream& os);
+    void exportJSON(ostream& os);
+    bool exportCSV(const string& file_name);
+    bool exportJSON(const string& file_name);
+
+    void clear();
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "PathORAM.h"
+#include "PCDORAM.h"
+#include "Hierarchical.h"
+using namespace std;
+
+/*
+    Type-erased engine, so each level of a MixedHierarchical can run a different
+    ORAM algorithm. Exposes the subset of the engine interface HierarchicalBase
+    uses; engines are wrapped by EngineAdapter<E>.
+*/
+class AnyEngine {
+public:
+
+    enum Operations {
+        read = 1,
+        write = 2,
+        write_back = 4,
+        dummy = 8,
+        checkout = 16
+    };
+
+    struct StashView {
+        AnyEngine* owner;
+        bool isFull(int margin = 0) { return owner->stashIsFull(margin); }
+        bool isAlmostFull() { return owner->stashIsAlmostFull(); }
+        int getCurrentStashSize() { return owner->stashSize(); }
+        int getPeakOccupancy() { return owner->stashPeak(); }
+        int getMaxStashSize() { return owner->stashCapacity(); }
+    };
+
+    StashView stash;
+
+    AnyEngine() { stash.owner = this; }
+    virtual ~AnyEngine() {}
+
+    virtual const char* getEngineName() = 0;
+
+    virtual int configParameters(uint64_t ds_s, uint64_t oram_s, int bl_s, int bn_p, int st_s, bool isDebug) = 0;
+    virtual void initialize() = 0;
+    virtual void setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b) = 0;
+    virtual void setSeed(unsigned s) = 0;
+    virtual void setReplayLog(ReplayLog* log) = 0;
+    virtual void resetMetric() = 0;
+    virtual void setDebug(bool debug) = 0;
+    virtual void setPathPrefetch(bool on) = 0;
+    virtual void setIntegrity(int mode, int hash_bytes, int hash_cycles) = 0;
+    virtual IntegrityTree& getIntegrityTree() = 0;
+    virtual double feedbackTime() = 0;
+
+    virtual int64_t getBlockCount() = 0;
+    virtual int64_t getBucketCount() = 0;
+    virtual int64_t getRealBlockCount() = 0;
+    virtual int getLevelCount() = 0;
+    virtual int64_t* getPositionMap() = 0;
+
+    virtual int64_t getAccessCount() = 0;
+    virtual int64_t getActualAccessCount() = 0;
+    virtual int64_t getDummyAccessCount() = 0;
+    virtual int64_t getMemoryAccessCount() = 0;
+
+    virtual int64_t getRA_PathReadCount() = 0;
+    virtual int64_t getDA_PathReadCount() = 0;
+    virtual int64_t getRA_PathWriteCount() = 0;
+    virtual int64_t getDA_PathWriteCount() = 0;
+    virtual int64_t getRA_RealBlockReadCount() = 0;
+    virtual int64_t getDA_RealBlockReadCount() = 0;
+    virtual int64_t getRA_RealBlockWriteCount() = 0;
+    virtual int64_t getDA_RealBlockWriteCount() = 0;
+    virtual int64_t getRA_DummyBlockReadCount() = 0;
+    virtual int64_t getDA_DummyBlockReadCount() = 0;
+    virtual int64_t getRA_DummyBlockWriteCount() = 0;
+    virtual int64_t getDA_DummyBlockWriteCount() = 0;
+
+    virtual int64_t getStashHit() = 0;
+    virtual int64_t getStashMiss() = 0;
+    virtual int64_t getRA_MemoryAccessCount() = 0;
+    virtual int64_t getDA_MemoryAccessCount() = 0;
+    virtual int64_t getRA_StashHit() = 0;
+    virtual int64_t getDA_StashHit() = 0;
+
+    virtual uint64_t getHitLatency() = 0;
+    virtual uint64_t getReadyLatency() = 0;
+    virtual uint64_t getWorstCaseLatency() = 0;
+
+    virtual Histogram& getLatencyHistogram() = 0;
+    virtual Histogram& getTrafficHistogram() = 0;
+    virtual Histogram& getOccupancyHistogram() = 0;
+    virtual void reportEngineHistograms(ostream& os, const string& prefix) = 0;
+
+    virtual int64_t access(int64_t id, short operation, int64_t data) = 0;
+    virtual int64_t backgroundEviction() = 0;
+    virtual void prefetch(int64_t id) = 0;
+
+    virtual bool stashIsFull(int margin) = 0;
+    virtual bool stashIsAlmostFull() = 0;
+    virtual int stashSize() = 0;
+    virtual int stashPeak() = 0;
+    virtual int stashCapacity() = 0;
+};
+
+inline const char* engineName(PathORAM&) { return "PathORAM"; }
+inline const char* engineName(PCDORAM&) { return "PCDORAM"; }
+
+inline void reportEngineHistograms(ostream&, const string&, PathORAM&) {}
+inline void reportEngineHistograms(ostream& os, const string& prefix, PCDORAM& oram) {
+    oram.getTemporalOccupancyHistogram().report(os, prefix + "temporal area occupancy");
+    oram.getCandidateOccupancyHistogram().report(os, prefix + "candidate area occupancy");
+}
+
+template <class E>
+class EngineAdapter : public AnyEngine {
+public:
+    E engine;
+
+    const char* getEngineName() { return engineName(engine); }
+
+    int configParameters(uint64_t ds_s, uint64_t oram_s, int bl_s, int bn_p, int st_s, bool isDebug) {
+        return engine.configParameters(ds_s, oram_s, bl_s, bn_p, st_s, isDebug);
+    }
+    void initialize() { engine.initialize(); }
+    void setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b) { engine.setDefaultLatencyParas(h_d, h_t_m, r, w_b); }
+    void setSeed(unsigned s) { engine.setSeed(s); }
+    void setReplayLog(ReplayLog* log) { engine.setReplayLog(log); }
+    void resetMetric() { engine.resetMetric(); }
+    void setDebug(bool debug) { engine.setDebug(debug); }
+    void setPathPrefetch(bool on) { engine.setPathPrefetch(on); }
+    void setIntegrity(int mode, int hash_bytes, int hash_cycles) { engine.setIntegrity(mode, hash_bytes, hash_cycles); }
+    IntegrityTree& getIntegrityTree() { return engine.getIntegrityTree(); }
+    double feedbackTime() { return engine.feedbackTime(); }
+
+    int64_t getBlockCount() { return engine.getBlockCount(); }
+    int64_t getBucketCount() { return engine.getBucketCount(); }
+    int64_t getRealBlockCount() { return engine.getRealBlockCount(); }
+    int getLevelCount() { return engine.getLevelCount(); }
+    int64_t* getPositionMap() { return engine.getPositionMap(); }
+
+    int64_t getAccessCount() { return engine.getAccessCount(); }
+    int64_t getActualAccessCount() { return engine.getActualAccessCount(); }
+    int64_t getDummyAccessCount() { return engine.getDummyAccessCount(); }
+    int64_t getMemoryAccessCount() { return engine.getMemoryAccessCount(); }
+
+    int64_t getRA_PathReadCount() { return engine.getRA_PathReadCount(); }
+    int64_t getDA_PathReadCount() { return engine.getDA_PathReadCount(); }
+    int64_t getRA_PathWriteCount() { return engine.getRA_PathWriteCount(); }
+    int64_t getDA_PathWriteCount() { return engine.getDA_PathWriteCount(); }
+    int64_t getRA_RealBlockReadCount() { return engine.getRA_RealBlockReadCount(); }
+    int64_t getDA_RealBlockReadCount() { return engine.getDA_RealBlockReadCount(); }
+    int64_t getRA_RealBlockWriteCount() { return engine.getRA_RealBlockWriteCount(); }
+    int64_t getDA_RealBlockWriteCount() { return engine.getDA_RealBlockWriteCount(); }
+    int64_t getRA_DummyBlockReadCount() { return engine.getRA_DummyBlockReadCount(); }
+    int64_t getDA_DummyBlockReadCount() { return engine.getDA_DummyBlockReadCount(); }
+    int64_t getRA_DummyBlockWriteCount() { return engine.getRA_DummyBlockWriteCount(); }
+    int64_t getDA_DummyBlockWriteCount() { return engine.getDA_DummyBlockWriteCount(); }
+
+    int64_t getStashHit() { return engine.getStashHit(); }
+    int64_t getStashMiss() { return engine.getStashMiss(); }
+    int64_t getRA_MemoryAccessCount() { return engine.getRA_MemoryAccessCount(); }
+    int64_t getDA_MemoryAccessCount() { return engine.getDA_MemoryAccessCount(); }
+    int64_t getRA_StashHit() { return engine.getRA_StashHit(); }
+    int64_t getDA_StashHit() { return engine.getDA_StashHit(); }
+
+    uint64_t getHitLatency() { return engine.getHitLatency(); }
+    uint64_t getReadyLatency() { return engine.getReadyLatency(); }
+    uint64_t getWorstCaseLatency() { return engine.getWorstCaseLatency(); }
+
+    Histogram& getLatencyHistogram() { return engine.getLatencyHistogram(); }
+    Histogram& getTrafficHistogram() { return engine.getTrafficHistogram(); }
+    Histogram& getOccupancyHistogram() { return engine.getOccupancyHistogram(); }
+    void reportEngineHistograms(ostream& os, const string& prefix) { ::reportEngineHistograms(os, prefix, engine); }
+
+    int64_t access(int64_t id, short operation, int64_t data) { return engine.access(id, operation, data); }
+    int64_t backgroundEviction() { return engine.backgroundEviction(); }
+    void prefetch(int64_t id) { engine.prefetch(id); }
+
+    bool stashIsFull(int margin) { return engine.stash.isFull(margin); }
+    bool stashIsAlmostFull() { return engine.stash.isAlmostFull(); }
+    int stashSize() { return engine.stash.getCurrentStashSize(); }
+    int stashPeak() { return engine.stash.getPeakOccupancy(); }
+    int stashCapacity() { return engine.stash.getMaxStashSize(); }
+};
+
+/*
+    Hierarchy whose levels each pick their engine through LevelConfig::engine,
+    e.g. PCDORAM for the skewed data level and PathORAM for the uniformly
+    accessed position map levels, each with its own stash size.
+*/
+class MixedHierarchical : public HierarchicalBase<MixedHierarchical, AnyEngine> {
+private:
+    friend class HierarchicalBase<MixedHierarchical, AnyEngine>;
+
+    static const char* levelName() { return "mixed level"; }
+
+    AnyEngine* createLevel(int level) {
+        switch (level_config[level].engine) {
+        case LevelConfig::pcd_oram: return new EngineAdapter<PCDORAM>;
+        default: return new EngineAdapter<PathORAM>;
+        }
+    }
+
+    void reportLevelHistograms(ostream& os, const string& prefix, AnyEngine& oram) {
+        oram.reportEngineHistograms(os, prefix);
+    }
+
+public:
+    const char* getEngineName(int index) { return levels[index]->getEngineName(); }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include "Histogram.h"
+using namespace std;
+
+// one request of a per-core binary trace; files are a raw array of these
+struct TraceRecord {
+    uint64_t timestamp;     // issue time in trace ticks
+    int64_t id;             // block id, folded into the data ORAM's range
+    int32_t operation;      // PathORAM / PCDORAM Operations value
+    int32_t reserved;
+};
+
+/*
+    Front end modelling many cores sharing one ORAM controller.
+    Per-core traces are mmapped and merged by issue time (k-way heap merge); the
+    controller serves one request at a time and the service time of a request is
+    the modeled latency of its access() plus any background eviction it triggers.
+    Requests arriving while the controller is busy queue up, so queueing delay and
+    stash hits are measured under contention instead of on a serialized stream.
+    Issue times count from each core's first record, so replica cores starting
+    mid-trace issue right away, and keep increasing when a core wraps around.
+*/
+class MultiCoreFrontEnd {
+private:
+    struct Core {
+        int trace;              // index into traces
+        int64_t cursor;
+        int64_t remaining;
+        int64_t tick_offset;    // added to trace timestamps: rebases them on the core's first record, plus a span per wrap
+        uint64_t last_issue;
+        uint64_t last_finish;
+        int64_t served;
+        int64_t stash_hits;
+        Histogram response_hist;
+    };
+
+    struct Trace {
+        string file_name;
+        const TraceRecord* records;
+        int64_t length;
+        uint64_t span;          // ticks from the first record to the first record of the next pass
+        void* mapping;
+        size_t mapped_size;
+        vector<TraceRecord> buffer;     // used where mmap is unavailable
+    };
+
+    vector<Trace> traces;
+    vector<Core> cores;
+    int core_count;
+    double time_scale;
+    double issue_rate;
+    bool blocking;
+
+    Histogram queue_delay_hist;
+    Histogram response_hist;
+    uint64_t makespan;
+    int64_t served;
+
+    void prepareCores();
+    uint64_t nextIssueTime(int core);
+    const TraceRecord& currentRecord(int core);
+
+public:
+    MultiCoreFrontEnd();
+    ~MultiCoreFrontEnd();
+
+    // each trace feeds one core
+    bool addCoreTrace(const string& file_name);
+    // more cores than traces replay the traces from staggered offsets, fewer cores drop the extra traces
+    void setCoreCount(int n);
+    int getCoreCount();
+    // cycles per trace tick when issuing by timestamp
+    void setTimeScale(double cycles_per_tick);
+    // requests per 1000 cycles per core, overriding trace timestamps; 0 issues by timestamp
+    void setIssueRate(double per_kilocycle);
+    // a blocking core issues its next request only after the previous one completed
+    void setBlocking(bool b);
+
+    template <class HierORAM>
+    void run(HierORAM& oram, int64_t max_requests = -1);
+
+    int64_t getServedCount();
+    uint64_t getMakespan();
+    Histogram& getQueueDelayHistogram();
+    Histogram& getResponseHistogram();
+    void report(ostream& os);
+
+    static bool writeTrace(const string& file_name, const vector<TraceRecord>& records);
+};
+
+template <class HierORAM>
+void MultiCoreFrontEnd::run(HierORAM& oram, int64_t max_requests) {
+    prepareCores();
+    int64_t blocks = oram.getRealBlockCountOfDataORAM();
+    uint64_t server_free = 0;
+
+    typedef pair<uint64_t, int> Pending;       // (issue time, core)
+    priority_queue<Pending, vector<Pending>, greater<Pending> > heap;
+    for (int c = 0; c < (int)cores.size(); c++)
+        if (cores[c].remaining > 0)
+            heap.push(Pending(nextIssueTime(c), c));
+
+    while (!heap.empty() && (max_requests < 0 || served < max_requests)) {
+        uint64_t issue = heap.top().first;
+        int c = heap.top().second;
+        heap.pop();
+        Core& core = cores[c];
+        const TraceRecord& r = currentRecord(c);
+
+        uint64_t latency_before = oram.getHitLatency() + oram.getReadyLatency();
+        int64_t hits_before = oram.getRA_StashHitCountOfDataORAM();
+        oram.access(((r.id % blocks) + blocks) % blocks, (short)r.operation, r.id);
+        oram.backgroundEviction();
+        uint64_t service = oram.getHitLatency() + oram.getReadyLatency() - latency_before;
+
+        uint64_t start = max(issue, server_free);
+        uint64_t finish = start + service;
+        server_free = finish;
+        queue_delay_hist.record(start - issue);
+        response_hist.record(finish - issue);
+        core.response_hist.record(finish - issue);
+        core.stash_hits += oram.getRA_StashHitCountOfDataORAM() - hits_before;
+        core.served++;
+        core.last_issue = issue;
+        core.last_finish = finish;
+        makespan = max(makespan, finish);
+        served++;
+
+        core.cursor = (core.cursor + 1) % traces[core.trace].length;
+        if (core.cursor == 0)
+            core.tick_offset += traces[core.trace].span;
+        if (--core.remaining > 0)
+            heap.push(Pending(nextIssueTime(c), c));
+    }
+}
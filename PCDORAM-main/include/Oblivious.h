@@ -0,0 +1,332 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include "TreeLayout.h"
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+/*
+    Branch-free building blocks for the oblivious stash: every routine touches
+    the same addresses in the same order whatever the block ids and leaves,
+    and selects with masks instead of branches, so the controller's own memory
+    trace (as seen by an enclave host) is independent of the stash contents.
+    Only sizes and loop bounds, which are public, decide control flow.
+
+    Every access still scans the whole stash and compacts it in O(n log n),
+    so it costs more than the regular stash (see MicroBenchmark). PathORAM
+    and PCDORAM take it through setObliviousStash(); builds for an enclave
+    define ORAM_OBLIVIOUS=1 to make it their default.
+*/
+#ifndef ORAM_OBLIVIOUS
+#define ORAM_OBLIVIOUS 0
+#endif
+
+// a stash entry in oblivious mode; id -1 marks an empty entry
+struct ObliviousBlock {
+    int64_t id;
+    int64_t leaf;       // stored with the block, looking it up in the position map would leak the id
+    int64_t key;        // scratch, e.g. the eviction target
+    int64_t tag;        // kept for the engine, e.g. PCDORAM's access frequency
+};
+
+inline int64_t oselect(bool c, int64_t a, int64_t b) {
+    return b ^ ((a ^ b) & -(int64_t)c);
+}
+
+inline int64_t omin(int64_t a, int64_t b) { return oselect(a < b, a, b); }
+
+inline void oswap(ObliviousBlock& a, ObliviousBlock& b, bool c) {
+#if defined(__AVX2__)
+    static_assert(sizeof(ObliviousBlock) == 32, "oswap moves a block as one 256-bit lane");
+    __m256i m = _mm256_set1_epi64x(-(int64_t)c);
+    __m256i x = _mm256_loadu_si256((const __m256i*)&a), y = _mm256_loadu_si256((const __m256i*)&b);
+    __m256i t = _mm256_and_si256(_mm256_xor_si256(x, y), m);
+    _mm256_storeu_si256((__m256i*)&a, _mm256_xor_si256(x, t));
+    _mm256_storeu_si256((__m256i*)&b, _mm256_xor_si256(y, t));
+#else
+    int64_t m = -(int64_t)c;
+    int64_t t = (a.id ^ b.id) & m;
+    a.id ^= t;
+    b.id ^= t;
+    t = (a.leaf ^ b.leaf) & m;
+    a.leaf ^= t;
+    b.leaf ^= t;
+    t = (a.key ^ b.key) & m;
+    a.key ^= t;
+    b.key ^= t;
+    t = (a.tag ^ b.tag) & m;
+    a.tag ^= t;
+    b.tag ^= t;
+#endif
+}
+
+/*
+    Indexed access to small tables (per-level counters, path slots) that reads
+    or writes every element, so the index stays hidden. 8 elements per
+    instruction with AVX-512, 4 with AVX2, scalar for the tail and other
+    targets. Out-of-range indices (e.g. -1) touch nothing.
+*/
+inline int64_t obliviousRead(const int64_t* a, int n, int64_t at, int64_t missing) {
+    int64_t value = 0, found = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i acc4 = _mm256_setzero_si256();
+#endif
+#if defined(__AVX512F__)
+    __m512i at8 = _mm512_set1_epi64(at), index8 = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), acc8 = _mm512_setzero_si512();
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 m = _mm512_cmpeq_epi64_mask(index8, at8);
+        acc8 = _mm512_mask_or_epi64(acc8, m, acc8, _mm512_loadu_si512((const void*)(a + i)));
+        found |= m;
+        index8 = _mm512_add_epi64(index8, _mm512_set1_epi64(8));
+    }
+    // halves reduced by the AVX2 tail; maskz avoids GCC 12's false -Wmaybe-uninitialized on the plain extract
+    acc4 = _mm256_or_si256(_mm512_maskz_extracti64x4_epi64(0xF, acc8, 0), _mm512_maskz_extracti64x4_epi64(0xF, acc8, 1));
+#endif
+#if defined(__AVX2__)
+    __m256i at4 = _mm256_set1_epi64x(at), index4 = _mm256_setr_epi64x(i, i + 1, i + 2, i + 3);
+    for (; i + 4 <= n; i += 4) {
+        __m256i m = _mm256_cmpeq_epi64(index4, at4);
+        acc4 = _mm256_or_si256(acc4, _mm256_and_si256(m, _mm256_loadu_si256((const __m256i*)(a + i))));
+        found |= _mm256_movemask_pd(_mm256_castsi256_pd(m));
+        index4 = _mm256_add_epi64(index4, _mm256_set1_epi64x(4));
+    }
+    __m128i acc2 = _mm_or_si128(_mm256_castsi256_si128(acc4), _mm256_extracti128_si256(acc4, 1));
+    value |= _mm_cvtsi128_si64(acc2) | _mm_extract_epi64(acc2, 1);
+#endif
+    for (; i < n; i++) {
+        int64_t m = -(int64_t)(i == at);
+        value |= a[i] & m;
+        found |= m;
+    }
+    return oselect(found != 0, value, missing);
+}
+
+inline void obliviousWrite(int64_t* a, int n, int64_t at, int64_t v) {
+    int i = 0;
+#if defined(__AVX512F__)
+    __m512i at8 = _mm512_set1_epi64(at), index8 = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), v8 = _mm512_set1_epi64(v);
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 m = _mm512_cmpeq_epi64_mask(index8, at8);
+        _mm512_storeu_si512((void*)(a + i), _mm512_mask_mov_epi64(_mm512_loadu_si512((const void*)(a + i)), m, v8));
+        index8 = _mm512_add_epi64(index8, _mm512_set1_epi64(8));
+    }
+#endif
+#if defined(__AVX2__)
+    __m256i at4 = _mm256_set1_epi64x(at), index4 = _mm256_setr_epi64x(i, i + 1, i + 2, i + 3), v4 = _mm256_set1_epi64x(v);
+    for (; i + 4 <= n; i += 4) {
+        __m256i m = _mm256_cmpeq_epi64(index4, at4);
+        _mm256_storeu_si256((__m256i*)(a + i), _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), v4, m));
+        index4 = _mm256_add_epi64(index4, _mm256_set1_epi64x(4));
+    }
+#endif
+    for (; i < n; i++)
+        a[i] = oselect(i == at, v, a[i]);
+}
+
+struct KeepReal {
+    bool operator()(const ObliviousBlock& b) const { return b.id != -1; }
+};
+
+template <class Keep>
+inline size_t obliviousCount(const ObliviousBlock* a, size_t n, Keep keep) {
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++)
+        m += keep(a[i]);
+    return m;
+}
+
+inline size_t obliviousCountReal(const ObliviousBlock* a, size_t n) { return obliviousCount(a, n, KeepReal()); }
+
+/*
+    Order-preserving tight compaction (Sasy, Johnson and Goldberg's ORCompact),
+    O(n log n) swaps: the entries `keep` accepts, by default the real ones,
+    move to the front in their original order. The offset variant compacts a
+    power-of-two range to start at position z (mod n).
+*/
+template <class Keep>
+inline void obliviousOffCompact(ObliviousBlock* a, size_t n, size_t z, Keep keep) {
+    if (n < 2)
+        return;
+    if (n == 2) {
+        oswap(a[0], a[1], (!keep(a[0]) & keep(a[1])) ^ (z != 0));
+        return;
+    }
+    size_t h = n / 2;
+    size_t m = obliviousCount(a, h, keep);
+    obliviousOffCompact(a, h, z & (h - 1), keep);
+    obliviousOffCompact(a + h, h, (z + m) & (h - 1), keep);
+    bool s = ((z & (h - 1)) + m >= h) ^ (z >= h);
+    size_t split = (z + m) & (h - 1);
+    for (size_t i = 0; i < h; i++)
+        oswap(a[i], a[i + h], s ^ (i >= split));
+}
+
+template <class Keep>
+inline void obliviousCompact(ObliviousBlock* a, size_t n, Keep keep) {
+    if (n < 2)
+        return;
+    size_t n1 = 1;
+    while (n1 * 2 <= n)
+        n1 *= 2;
+    size_t n2 = n - n1;
+    size_t m = obliviousCount(a, n2, keep);
+    obliviousCompact(a, n2, keep);
+    obliviousOffCompact(a + n2, n1, (n1 - n2 + m) & (n1 - 1), keep);
+    for (size_t i = 0; i < n2; i++)
+        oswap(a[i], a[i + n1], i >= m);
+}
+
+inline void obliviousCompact(ObliviousBlock* a, size_t n) { obliviousCompact(a, n, KeepReal()); }
+
+/*
+    The compaction network run backwards: the leading entries move, in order,
+    to the positions flagged in `marked`, the others to the rest, O(n log n)
+    swaps. The swap decisions come from the marks the way compaction takes
+    them from the entries it keeps.
+*/
+inline size_t obliviousCountMarked(const uint8_t* marked, size_t n) {
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++)
+        m += marked[i];
+    return m;
+}
+
+inline void obliviousOffExpand(ObliviousBlock* a, const uint8_t* marked, size_t n, size_t z) {
+    if (n < 2)
+        return;
+    if (n == 2) {
+        oswap(a[0], a[1], (!marked[0] & marked[1]) ^ (z != 0));
+        return;
+    }
+    size_t h = n / 2;
+    size_t m = obliviousCountMarked(marked, h);
+    bool s = ((z & (h - 1)) + m >= h) ^ (z >= h);
+    size_t split = (z + m) & (h - 1);
+    for (size_t i = 0; i < h; i++)
+        oswap(a[i], a[i + h], s ^ (i >= split));
+    obliviousOffExpand(a, marked, h, z & (h - 1));
+    obliviousOffExpand(a + h, marked + h, h, (z + m) & (h - 1));
+}
+
+inline void obliviousExpand(ObliviousBlock* a, const uint8_t* marked, size_t n) {
+    if (n < 2)
+        return;
+    size_t n1 = 1;
+    while (n1 * 2 <= n)
+        n1 *= 2;
+    size_t n2 = n - n1;
+    size_t m = obliviousCountMarked(marked, n2);
+    for (size_t i = 0; i < n2; i++)
+        oswap(a[i], a[i + n1], i >= m);
+    obliviousOffExpand(a + n2, marked + n2, n1, (n1 - n2 + m) & (n1 - 1));
+    obliviousExpand(a, marked, n2);
+}
+
+/*
+    Bitonic sort by key for any n (the halves of a merge need not be powers of
+    two), O(n log^2 n) compare-exchanges whose positions depend on n only.
+    For short arrays, e.g. the Z * L blocks evicted to a path; long ones are
+    compacted first.
+*/
+inline void obliviousBitonicMerge(ObliviousBlock* a, size_t n, bool up) {
+    if (n < 2)
+        return;
+    size_t m = 1;
+    while (m * 2 < n)
+        m *= 2;
+    for (size_t i = 0; i + m < n; i++)
+        oswap(a[i], a[i + m], (a[i].key > a[i + m].key) == up);
+    obliviousBitonicMerge(a, m, up);
+    obliviousBitonicMerge(a + m, n - m, up);
+}
+
+inline void obliviousSort(ObliviousBlock* a, size_t n, bool up = true) {
+    if (n < 2)
+        return;
+    size_t h = n / 2;
+    obliviousSort(a, h, !up);
+    obliviousSort(a + h, n - h, up);
+    obliviousBitonicMerge(a, n, up);
+}
+
+// moves b into the first empty entry of a[0, n); b is left empty if there was one
+inline void obliviousInsert(ObliviousBlock* a, size_t n, ObliviousBlock& b) {
+    bool pending = b.id != -1;
+    for (size_t i = 0; i < n; i++) {
+        bool put = pending & (a[i].id == -1);
+        oswap(a[i], b, put);
+        pending &= !put;
+    }
+}
+
+/*
+    The placement of the engines' pickBlockstoEvict, without data-dependent
+    branches or addresses: the entries `eligible` accepts go deepest first,
+    leaf to root, into the free[l] free slots of each level l (root first) of
+    the path to cur_pos. Depths take only L values, so instead of sorting,
+    a histogram of the depths tells how many blocks the greedy fill places
+    on each level and the depth `cut` where the evicted blocks run out: every
+    block deeper than cut leaves, and the first rem of those at cut. Within a
+    bucket the order does not matter, so the evicted entries are compacted
+    into the first Z * L, sorted there by depth and expanded onto the taken
+    slots, root first; the stash is compacted again afterwards.
+    O(n L / 4 + n log n) for n entries, plus O(Z L log^2 (Z L)) for the sort.
+
+    On return queue[l * z + j] holds the j-th block placed on level l, -1
+    after the last one; taken is z * level_count bytes of scratch. Returns the
+    number of evicted blocks.
+*/
+template <class Eligible>
+inline int64_t obliviousEvictPath(ObliviousBlock* e, int64_t n, int64_t cur_pos, int64_t leaf_count, int level_count, int z,
+                                  const int64_t* free, Eligible eligible, uint8_t* taken, int64_t* queue, int32_t* queue_leaf) {
+    assert(level_count <= 64);
+    int64_t count[64] = { 0 }, placed[64];
+    for (int64_t k = 0; k < n; k++) {		// key: the deepest legal level, -1 if the entry stays
+        int64_t depth = oselect(eligible(e[k]), deepestSharedLevel(e[k].leaf, cur_pos, leaf_count, level_count), -1);
+        for (int l = 0; l < level_count; l++)
+            count[l] += depth == l;
+        e[k].key = depth;
+    }
+    int64_t blocks = 0, total = 0;
+    for (int l = level_count - 1; l >= 0; l--) {
+        blocks += count[l];
+        placed[l] = omin(free[l], blocks - total);
+        total += placed[l];
+    }
+    int64_t cut = level_count, rem = 0, deeper = 0;		// cut stays past the leaves if nothing is evicted
+    for (int l = level_count - 1; l >= 0; l--) {
+        bool here = (deeper < total) & (deeper + count[l] >= total);
+        cut = oselect(here, l, cut);
+        rem = oselect(here, total - deeper, rem);
+        deeper += count[l];
+    }
+
+    int path_slots = level_count * z;
+    int64_t seen = 0;
+    for (int64_t k = 0; k < n; k++) {		// key: the depth of an evicted entry, path_slots for one that stays
+        int64_t depth = e[k].key;
+        bool at_cut = depth == cut;
+        bool evicted = (depth > cut) | (at_cut & (seen < rem));
+        seen += at_cut;
+        e[k].key = oselect(evicted, depth, path_slots);
+    }
+    for (int s = 0; s < path_slots; s++)
+        taken[s] = s % z < placed[s / z];
+
+    assert(n > path_slots);
+    obliviousCompact(e, n, [path_slots](const ObliviousBlock& b) { return b.key < path_slots; });
+    obliviousSort(e, path_slots);
+    obliviousExpand(e, taken, path_slots);
+    for (int s = 0; s < path_slots; s++) {
+        queue[s] = oselect(taken[s], e[s].id, -1);
+        queue_leaf[s] = (int32_t)oselect(taken[s], e[s].leaf, -1);
+        e[s].id = oselect(taken[s], -1, e[s].id);
+    }
+    obliviousCompact(e, n);
+    return total;
+}
@@ -14,6 +14,17 @@
 #include <unordered_map>
 #include <set>
 #include "LocalCacheLine.h"
+#include "ReplayLog.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include "Histogram.h"
+#include "EvictPathPool.h"
+#include "TreeLayout.h"
+#include "BucketScan.h"
+#include "PoolAllocator.h"
+#include "StashArea.h"
+#include "IntegrityTree.h"
+#include "Oblivious.h"
 
 using namespace std;
 
@@ -31,29 +42,81 @@ private:
     friend class PCDORAM;
 public:
 
-    unordered_map<int64_t, LocalCacheLine> temporal_area;
-    unordered_map<int64_t, list<LocalCacheLine>::iterator> candidate_area_key;
-    unordered_map<int64_t, int64_t> candidate_area_key_freq;
-    unordered_map<int64_t, list<LocalCacheLine> > candidate_area_freq;
-
-    Stash5() {
+    StashArea temporal_area;
+    NodeArena arena;		// nodes of the maps and frequency lists below, reserved for a full stash by setMaxStashSize()
+    PoolMap<int64_t, PoolList<LocalCacheLine>::iterator> candidate_area_key;
+    PoolMap<int64_t, int64_t> candidate_area_key_freq;
+    PoolMap<int64_t, PoolList<LocalCacheLine> > candidate_area_freq;
+    vector<int64_t> candidate_freq_count;		// candidate blocks per access frequency, kept in step with candidate_area_freq
+    int64_t candidate_max_freq;
+
+    // oblivious mode: both areas live in entries, the real ones packed at the
+    // front; tag is a candidate block's access frequency, 0 in the temporal area
+    bool oblivious;
+    vector<ObliviousBlock> entries;
+    int entry_count;
+    int candidate_count;
+
+    // occupancy after each access
+    Histogram occupancy_hist;
+    Histogram temporal_occupancy_hist;
+    Histogram candidate_occupancy_hist;
+
+    Stash5()
+        : candidate_area_key(0, hash<int64_t>(), equal_to<int64_t>(), PoolAllocator<char>(&arena)),
+          candidate_area_key_freq(0, hash<int64_t>(), equal_to<int64_t>(), PoolAllocator<char>(&arena)),
+          candidate_area_freq(0, hash<int64_t>(), equal_to<int64_t>(), PoolAllocator<char>(&arena)) {
         max_stash_size = 1024 * 1024;		// in MB
         peak_occupancy = 0;
         last_occupancy = 0;
+        candidate_max_freq = 0;
+        oblivious = false;
+        entry_count = 0;
+        candidate_count = 0;
+    }
+    void setMaxStashSize(int size) {
+        max_stash_size = size;
+        temporal_area.reserve(size);
+        candidate_area_key.reserve(size);
+        candidate_area_key_freq.reserve(size);
+        candidate_area_freq.reserve(size);
+        arena.reserveNodes(size, mapNodeBytes<int64_t, PoolList<LocalCacheLine>::iterator>()
+            + mapNodeBytes<int64_t, int64_t>() + listNodeBytes<LocalCacheLine>());
+        arena.reserveNodes(min(size, 64), mapNodeBytes<int64_t, PoolList<LocalCacheLine> >());		// one per distinct frequency
+    }
+    void setOblivious(bool on) {		// after setMaxStashSize(); the last 1 + Z * L entries hold a path read and a new block
+        oblivious = on;
+        ObliviousBlock empty = { -1, 0, 0, 0 };
+        entries.assign(on ? max_stash_size + 1 : 0, empty);
+        entry_count = 0;
+        candidate_count = 0;
     }
-    void setMaxStashSize(int size) { max_stash_size = size; } 
     void setZvalue(int Z) { Z_value = Z; }
     void setL(int l) { L = l; }
     void setBlocksize(int bs) { block_size = bs; }
     int getMaxStashSize() { return max_stash_size; }
     int getPeakOccupancy() { return peak_occupancy; }
     int getLastOccupancy() { return last_occupancy; }
-    int getCurrentStashSize() { return temporal_area.size() + candidate_area_key.size(); }
+    int temporalSize() { return oblivious ? entry_count - candidate_count : temporal_area.size(); }
+    int candidateSize() { return oblivious ? candidate_count : candidate_area_key.size(); }
+    int getCurrentStashSize() { return temporalSize() + candidateSize(); }
     void updatePeakAndLastOccupancy() {
-        last_occupancy = temporal_area.size() + candidate_area_key.size();
+        last_occupancy = getCurrentStashSize();
         peak_occupancy = (last_occupancy > peak_occupancy) ? last_occupancy : peak_occupancy;
     }
 
+    void recordOccupancy() {
+        occupancy_hist.record(getCurrentStashSize());
+        temporal_occupancy_hist.record(temporalSize());
+        candidate_occupancy_hist.record(candidateSize());
+    }
+
+    void resetOccupancyHistograms() {
+        occupancy_hist.reset();
+        temporal_occupancy_hist.reset();
+        candidate_occupancy_hist.reset();
+    }
+
     bool isFull(int margin = 0) {
         int upperLimit = max_stash_size - margin - Z_value * L;
         if (getCurrentStashSize() >= upperLimit)
@@ -71,21 +134,23 @@ public:
     bool isTemporalAreaAlmostEmpty() {
         int downerLimit = Z_value * L;
         //	int downerLimit = L;
-        if (temporal_area.size() <= downerLimit)
+        if (temporalSize() <= downerLimit)
             return true;
         return false;
     }
 
     void displayStash() {
+        for (int i = 0; oblivious && i < entry_count; i++)
+            cout << "(" << entries[i].tag << ", " << entries[i].id << ", " << entries[i].leaf << "), ";
         for (auto& ele : candidate_area_freq) {
             for (auto& node : ele.second) {
-                cout << "(" << ele.first << ", " << node.id << ", " << *(node.position) << "), ";
+                cout << "(" << ele.first << ", " << node.id << ", " << node.leaf << "), ";
             }
         }
         cout << endl;
 
         for (auto& t_ele : temporal_area)
-            cout << "(" << t_ele.second.id << ", " << *(t_ele.second.position) << "), ";
+            cout << "(" << t_ele.id << ", " << t_ele.leaf << "), ";
         cout << endl;
     }
 
@@ -96,7 +161,7 @@ public:
     void putIntoCandidateArea(LocalCacheLine data) {
         auto key_it = candidate_area_key.find(data.id);
         if (key_it != candidate_area_key.end()) { 
-            list<LocalCacheLine>::iterator no = candidate_area_key[data.id];
+            PoolList<LocalCacheLine>::iterator no = candidate_area_key[data.id];
             int freq = candidate_area_key_freq[data.id]; 
             candidate_area_freq[freq].erase(no);
             if (candidate_area_freq[freq].size() == 0) {
@@ -105,23 +170,65 @@ public:
             candidate_area_key_freq[data.id] = freq + 1; 
             candidate_area_freq[freq + 1].push_front(data);
             candidate_area_key[data.id] = candidate_area_freq[freq + 1].begin();
+            countFrequency(freq, -1);
+            countFrequency(freq + 1, 1);
         }
         else {
             candidate_area_key_freq[data.id] = 1;
             candidate_area_freq[1].push_front(data);
             candidate_area_key[data.id] = candidate_area_freq[1].begin();
+            countFrequency(1, 1);
         }
     }
 
+    void countFrequency(int64_t freq, int delta) {
+        if (freq >= (int64_t)candidate_freq_count.size())
+            candidate_freq_count.resize(max(freq + 1, (int64_t)candidate_freq_count.size() * 2), 0);
+        candidate_freq_count[freq] += delta;
+        if (delta > 0 && freq > candidate_max_freq)
+            candidate_max_freq = freq;
+    }
+
+    // rebuild candidate_freq_count, only needed if candidate_area_freq was edited directly
+    void recountFrequencies() {
+        fill(candidate_freq_count.begin(), candidate_freq_count.end(), 0);
+        candidate_max_freq = 0;
+        for (auto& f_ele : candidate_area_freq)
+            countFrequency(f_ele.first, f_ele.second.size());
+    }
+
+    void clearCandidateArea() {
+        candidate_area_key.clear();
+        candidate_area_key_freq.clear();
+        candidate_area_freq.clear();
+        fill(candidate_freq_count.begin(), candidate_freq_count.begin() + min((int64_t)candidate_freq_count.size(), candidate_max_freq + 1), 0);
+        candidate_max_freq = 0;
+    }
+
+    // drops the block, e.g. when it is checked out to the LLC
+    bool removeFromCandidateArea(int64_t block_id) {
+        auto key_it = candidate_area_key.find(block_id);
+        if (key_it == candidate_area_key.end())
+            return false;
+        int64_t freq = candidate_area_key_freq[block_id];
+        candidate_area_freq[freq].erase(key_it->second);
+        if (candidate_area_freq[freq].size() == 0)
+            candidate_area_freq.erase(freq);
+        candidate_area_key.erase(key_it);
+        candidate_area_key_freq.erase(block_id);
+        countFrequency(freq, -1);
+        return true;
+    }
+
     bool getFromTemporalArea(int64_t block_id) {
-        if (temporal_area.find(block_id) != temporal_area.end()) {
+        if (temporal_area.find(block_id) != NULL) {
             return true;
         }
         return false;
     }
 
     void putIntoTemporalArea(LocalCacheLine data) {
-        temporal_area[data.id] = data;
+        temporal_area.insert(data);
     }
 
     ~Stash5() { }
@@ -176,6 +283,25 @@ private:
 
     int64_t allocate_right_path_count;
     int64_t allocate_wrong_path_count;
+    int64_t delayed_eviction_count;
+
+    bool prefetch_paths;		// prefetch every bucket of a path before walking it
+    bool oblivious;		// stash kept in stash.entries and handled by the branch-free routines of Oblivious.h
+    vector<uint8_t> slot_taken;		// obliviousEvict scratch: path slots, root first, that receive a block
+    int64_t* path_buckets;		// buckets of the path being walked, root first
+
+    unsigned seed;
+    bool fixed_seed;
+    ReplayLog* replay_log;
+
+    Histogram latency_hist;		// modeled cycles per access
+    Histogram traffic_hist;		// blocks moved per access
+
+    IntegrityTree integrity;
+
+    int64_t finishAccess(int64_t IO_traffic, uint64_t latency_before);
+    int64_t openIntegrity(int64_t leaf_label, bool content_read);
+    int64_t closeIntegrity();
 
 public:
 
@@ -183,25 +309,40 @@ public:
         read = 1,
         write = 2,
         write_back = 4,
-        dummy = 8
+        dummy = 8,
+        checkout = 16       // with read or write: the block leaves the ORAM for the LLC until its write_back
     };
 
     Stash5 stash;
 
     bool* present;		
+    bool* checked_out;      // held by the LLC: not in the tree or stash, and not present
     int64_t* position_map;		
+    // bucket metadata, apart from the payloads in block_data: slot ids, a valid
+    // bitmap per bucket and the leaf label each block was written with
     int64_t* program_address;	
+    uint64_t* bucket_valid;		// bit j: slot j holds a block
+    int32_t* slot_leaf;
     int64_t* block_data;		
-    int64_t* curPath_buffer;	
+    LocalCacheLine* curPath_buffer;	
 
     int64_t* quantity_map;    
+    vector<int> claimed_in_bucket;		// kick-out: slots planned per bucket, not in quantity_map yet
+    vector<int64_t> claimed_buckets;
+    vector<int64_t> kick_ids;		// kick-out: candidate ids, lowest access frequency first
+    vector<int64_t> kick_groups;		// and how many share each frequency
+    vector<int64_t> kick_slots;		// kick-out plan: the slot of each of the first kick_ids, grouped by path
+    vector<pair<int64_t, size_t> > kick_paths;		// (leaf, end of its slots in kick_slots)
 
     int64_t* evict_queue;
+    int32_t* evict_queue_leaf;		// leaf of each queued block
     int* evict_queue_count;
-    vector<int64_t> evict_backup_path;	
+    vector<pair<int, int> > evict_bins;		// (deepest legal level, temporal area position) scratch
+    vector<pair<int, int> > evict_order;
+    vector<int> depth_start;
+    EvictPathPool evict_backup_path;		// paths read but not written back yet
 
     int64_t max_freq;
-    set<pair<int64_t, int64_t> > freq_cnt;
 
     default_random_engine random_engine2;
     uniform_int_distribution<int> distribute_int;
@@ -222,6 +363,17 @@ public:
 
     void setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b);
 
+    void setSeed(unsigned s);		// must be called before configParameters()
+    unsigned getSeed();
+    void setReplayLog(ReplayLog* log);		// must be called before configParameters()
+    void setEvictPathPolicy(int policy, size_t capacity = 64);		// EvictPathPool::Policy, must be called before initialize()
+    void setPathPrefetch(bool on);
+    void setObliviousStash(bool on);		// default ORAM_OBLIVIOUS; must be called before initialize()
+    bool isObliviousStash();
+    // IntegrityTree::Mode, hash size in bytes and cycles per bucket hash; must be called before initialize()
+    void setIntegrity(int mode, int hash_bytes = 32, int hash_cycles = 80);
+    IntegrityTree& getIntegrityTree();
+
     int64_t getActualORAMsize();
     int getBlockSize();
     int getBlockNumPerBucket();
@@ -268,9 +420,17 @@ public:
     uint64_t getReadyLatency();
     int64_t getAvgHitLatency();
     int64_t getAvgReadyLatency();
+    uint64_t getWorstCaseLatency();
 
     int64_t getPathAllocateRightCount();
     int64_t getPathAllocateWrongCount();
+    int64_t getDelayedEvictionCount();
+
+    Histogram& getLatencyHistogram();
+    Histogram& getTrafficHistogram();
+    Histogram& getOccupancyHistogram();
+    Histogram& getTemporalOccupancyHistogram();
+    Histogram& getCandidateOccupancyHistogram();
 
     void resetMetric();
     void setDebug(bool debug);
@@ -284,15 +444,31 @@ public:
 
     int64_t access(int64_t id, short operation, int64_t data);
 
+    // start loading the path id is mapped to ahead of access(id); changes no state
+    void prefetch(int64_t id);
+
     int64_t generateFromEvictBackupPath();
 
+    int freeSlotsOnPath(int64_t leaf_label);
+
+    int64_t delayedEviction();
+
+    int64_t kickOutIfAlmostFull();
+
     int64_t readPath(int64_t interest, int64_t leaf_label, int64_t& index);
 
+    int64_t obliviousAccess(int64_t id, short operation, int64_t data, int64_t cur_pos, int64_t new_pos);
+
+    int64_t obliviousReadPath(int64_t interest, int64_t leaf_label, int64_t& index);
+
+    int64_t obliviousEvict(int64_t cur_pos);
+
     bool scanStash(int64_t interest);		
 
     void remap(int64_t interest, int64_t new_leaf);
 
     void resetEvictQueue();
+    void rebuildBucketMeta();		// after editing program_address directly, from the position map
 
     int locateTheIntersectionForTmpArea(LocalCacheLine block, int64_t cur_pos);
 
@@ -308,7 +484,9 @@ public:
 
     int locateTheIntersection(int64_t block_pos, int64_t cur_pos);
 
-    int64_t hybridBlockKickOut(bool isHalf);
+    void orderCandidates();
+
+    int64_t hybridBlockKickOut();
 
     void refreshQuantityMap(int cur_bucket, int numofPrev);
 
@@ -318,6 +496,10 @@ public:
 
     int64_t findTheBestFitPathForEvict(int neededSpace, bool& isLarge);
 
+    int64_t bestFitLeaf(int neededSpace, bool& isLarge);
+
+    void claimSlots(int64_t bucket_index, int n);
+
     string formatedLogFileName(const string& trace_name,const string& cur_time);
 
     string getFormatedTime();
@@ -13,6 +13,12 @@
 #include <random>
 #include "LocalCacheLine.h"
 #include "Stash.h"
+#include "ReplayLog.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include "TreeLayout.h"
+#include "BucketScan.h"
+#include "IntegrityTree.h"
 using namespace std;
 
 
@@ -52,25 +58,110 @@ private:
 	int remap_cycles;
 	int write_back_cycles;
 
+	unsigned seed;
+	bool fixed_seed;
+	ReplayLog *replay_log;
+
+	Histogram latency_hist;		// modeled cycles per access
+	Histogram traffic_hist;		// blocks moved per access
+
+	int eviction_mode;
+	int eviction_rate;		// reverse-lex mode: evict once every eviction_rate accesses
+	int accesses_since_eviction;
+	int64_t eviction_round;		// next path in reverse-lexicographic order
+	int64_t eviction_count;
+
+	bool prefetch_paths;		// prefetch every bucket of a path before walking it
+	int64_t *path_buckets;		// buckets of the path being walked, root first
+
+	bool oblivious;		// stash kept in stash.entries and handled by the branch-free routines of Oblivious.h
+	vector<uint8_t> slot_taken;		// obliviousEvict scratch: path slots, root first, that receive a block
+
+	IntegrityTree integrity;
+
+	int superblock_policy;
+	int superblock_max_log;		// superblocks hold up to 2^superblock_max_log blocks
+	vector<uint8_t> superblock_log;		// per block: its superblock is the aligned group of 2^log ids around it
+	vector<uint8_t> prefetched;		// per block: read along with its superblock and not requested since
+	vector<int8_t> merge_score;		// per aligned group: accesses to one half shortly after the other
+	vector<int8_t> use_score;		// per superblock: prefetched blocks used minus those evicted unused
+	vector<int64_t> last_touch;		// per block: actual_access_count when last requested, -1 if never
+	int64_t superblock_read_count;		// path reads that brought in more than the requested block
+	int64_t prefetch_count;
+	int64_t prefetch_hit_count;
+	int64_t prefetch_unused_count;
+	int64_t merge_count;
+	int64_t split_count;
+
+	int64_t finishAccess(int64_t IO_traffic, uint64_t latency_before);
+	int64_t openIntegrity(int64_t leaf_label, bool content_read);
+	int64_t closeIntegrity();
+	int64_t superblockStart(int64_t id);
+	int superblockInStash(int64_t start, int64_t size);
+	void remapSuperblock(int64_t id, int64_t new_leaf);
+	void markPrefetched(int64_t interest, int loaded);
+	void usePrefetched(int64_t id);
+	void dropPrefetched(int64_t id);
+	int64_t mergeSuperblocks(int64_t id);
+
 public:
 
 	enum Operations {
 		read = 1,
 		write = 2,
 		write_back = 4,
-		dummy = 8
+		dummy = 8,
+		checkout = 16		// with read or write: the block leaves the ORAM for the LLC until its write_back
+	};
+
+	/*
+		evict_read_path: write back along the path just read (default)
+		evict_reverse_lex: an access only takes the requested block off its
+			path, rewriting the path's bucket metadata; every eviction_rate accesses the next path in reverse-
+			lexicographic order is read and refilled from the stash, which
+			spreads evictions evenly over the tree
+	*/
+	enum EvictionMode {
+		evict_read_path,
+		evict_reverse_lex
+	};
+
+	/*
+		Superblocks (PrORAM): aligned groups of consecutive ids that share one
+		leaf, so the path read that misses on one of them brings all of them
+		into the stash, and they are remapped together.
+		superblock_off: every block has a leaf of its own
+		superblock_static: every group of `size` ids is a superblock
+		superblock_dynamic: blocks start alone; two adjacent superblocks of the
+			same size merge (up to `size`) once accesses to one keep following
+			accesses to the other, and a superblock splits once the blocks it
+			prefetches keep leaving the stash unused
+	*/
+	enum SuperblockPolicy {
+		superblock_off,
+		superblock_static,
+		superblock_dynamic
 	};
 
 	Stash stash;
 
 	bool *present;		
+	bool *checked_out;		// held by the LLC: not in the tree or stash, and not present
 	int64_t *position_map;		
+	// bucket metadata, apart from the payloads in block_data: slot ids, a valid
+	// bitmap per bucket and the leaf label each block was written with
 	int64_t *program_address;	
+	uint64_t *bucket_valid;		// bit j: slot j holds a block
+	int32_t *slot_leaf;
 	int64_t *block_data;		
-	int64_t *curPath_buffer;	
+	LocalCacheLine *curPath_buffer;	
 
 	int64_t *evict_queue;
+	int32_t *evict_queue_leaf;		// leaf of each queued block
 	int *evict_queue_count;
+	vector<pair<int, int> > evict_bins;		// (deepest legal level, stash position) scratch
+	vector<pair<int, int> > evict_order;
+	vector<int> depth_start;
 
 	default_random_engine random_engine;  
 	uniform_int_distribution<int> distribute_int; 
@@ -88,6 +179,23 @@ public:
 
 	void setDefaultLatencyParas(int h_d, int h_t_m, int r, int w_b);
 
+	void setSeed(unsigned s);		// must be called before configParameters()
+	unsigned getSeed();
+	void setReplayLog(ReplayLog *log);		// must be called before configParameters()
+	void setEvictionMode(int mode, int rate = 1);
+	void setPathPrefetch(bool on);
+	void setObliviousStash(bool on);		// default ORAM_OBLIVIOUS; must be called before initialize()
+	bool isObliviousStash();
+	// IntegrityTree::Mode, hash size in bytes and cycles per bucket hash; must be called before initialize()
+	void setIntegrity(int mode, int hash_bytes = 32, int hash_cycles = 80);
+	IntegrityTree &getIntegrityTree();
+	// size: a power of two; must be called before initialize(), not with the oblivious stash
+	void setSuperblocks(int policy, int size = 4);
+	int getSuperblockPolicy();
+	int getSuperblockSize(int64_t id);
+	int getEvictionMode();
+	int getEvictionRate();
+
 	int generateRandomLeaf();
 
 	int64_t getActualORAMsize();
@@ -105,6 +213,14 @@ public:
 	int64_t getActualAccessCount();
 	int64_t getDummyAccessCount();
 	int64_t getMemoryAccessCount();
+	int64_t getEvictionCount();
+
+	int64_t getSuperblockReadCount();
+	int64_t getPrefetchCount();		// blocks read in along with the requested one
+	int64_t getPrefetchHitCount();		// of which requested while still in the stash
+	int64_t getPrefetchUnusedCount();		// of which evicted before being requested
+	int64_t getMergeCount();
+	int64_t getSplitCount();
 
 	int64_t getRA_PathReadCount();
 	int64_t getDA_PathReadCount();
@@ -136,6 +252,11 @@ public:
 	uint64_t getReadyLatency();
 	int64_t getAvgHitLatency();
 	int64_t getAvgReadyLatency();
+	uint64_t getWorstCaseLatency();
+
+	Histogram &getLatencyHistogram();
+	Histogram &getTrafficHistogram();
+	Histogram &getOccupancyHistogram();
 
 	void resetMetric();
 	void setDebug(bool debug);
@@ -147,13 +268,25 @@ public:
 	
 	int64_t access(int64_t id, short operation, int64_t data);
 
+	// start loading the path id is mapped to ahead of access(id); changes no state
+	void prefetch(int64_t id);
+
 	int64_t readPath(int64_t interest, int64_t leaf_label, int64_t &index);
 
+	int64_t fetchFromPath(int64_t interest, int64_t leaf_label, int64_t &index);
+
+	int64_t obliviousAccess(int64_t id, short operation, int64_t data, int64_t cur_pos, int64_t new_pos);
+
+	int64_t obliviousReadPath(int64_t interest, int64_t leaf_label, bool whole_path, int64_t &index);
+
+	void obliviousEvict(int64_t cur_pos);
+
 	bool scanStash(int64_t interest);
 
 	void remap(int64_t interest, int64_t new_leaf);
 
 	void resetEvictQueue();
+	void rebuildBucketMeta();		// after editing program_address directly, from the position map
 
 	int locateTheIntersection(LocalCacheLine block, int64_t cur_pos);
 
@@ -163,6 +296,10 @@ public:
 
 	int64_t writePath(int leaf_label);
 
+	int64_t reverseLexLeaf(int64_t round);
+
+	int64_t evictPath(int64_t leaf_label);
+
 	int64_t backgroundEviction();
 
 	~PathORAM();
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include "Histogram.h"
+using namespace std;
+
+/*
+    Rate-controlled front end that hides ORAM access timing (Ascend-style).
+    Accesses run in slots of a fixed service budget plus `interval` idle
+    cycles. The budget defaults to the hierarchy's worst-case access latency
+    (getWorstCaseLatency: path reads and writes, a PCDORAM kick-out of the
+    whole stash, integrity), so no access overruns it and slot starts never
+    depend on what an access cost. A slot serves the oldest pending real
+    request, or is a dummy access on every level if none has arrived or a
+    stash needs background eviction. A smaller budget set with
+    setSlotService() trades that guarantee for throughput: an access that
+    overruns it pushes the schedule back by whole slots, which is counted and
+    leaks timing.
+    With adaptive rates the interval is re-chosen from a small candidate set
+    at the end of each epoch, and epochs double in length, so the rate
+    sequence leaks at most log2(#rates) bits per epoch.
+
+    runOnDemand() serves the same requests as soon as they arrive, with only
+    the stash-driven background eviction, as the baseline the cost of timing
+    protection is measured against.
+*/
+class PeriodicScheduler {
+public:
+    struct Request {
+        uint64_t arrival;       // cycle the request reaches the controller
+        int64_t id;
+        short operation;
+    };
+
+    struct Stats {
+        int64_t real_count;
+        int64_t dummy_count;
+        int64_t overrun_count;      // slots whose access exceeded the service budget
+        uint64_t makespan;
+        uint64_t traffic;
+        int rate_changes;
+        Histogram response_hist;
+    };
+
+private:
+    vector<Request> requests;
+    uint64_t interval;
+    vector<uint64_t> rates;         // candidate intervals, empty: fixed interval
+    uint64_t first_epoch;
+    uint64_t slot_service;          // service budget of a slot, 0: the hierarchy's worst case
+
+    uint64_t chooseInterval(int64_t arrivals, uint64_t epoch_length, uint64_t service);
+    void resetStats(Stats& s);
+
+public:
+    PeriodicScheduler(uint64_t i = 1000);
+
+    void setInterval(uint64_t i);
+    // candidate intervals and the length of the first epoch in cycles
+    void setAdaptive(const vector<uint64_t>& candidates, uint64_t first_epoch_cycles);
+    uint64_t getInterval();
+    // service budget of a slot below the worst case; overruns then show in the stats
+    void setSlotService(uint64_t cycles);
+
+    void submit(uint64_t arrival, int64_t id, short operation);
+    void clear();
+    int64_t getRequestCount();
+
+    template <class HierORAM> Stats runPeriodic(HierORAM& oram);
+    template <class HierORAM> Stats runOnDemand(HierORAM& oram);
+
+    // side-by-side comparison, including the throughput lost to dummy accesses
+    static void report(ostream& os, Stats& periodic, Stats& on_demand);
+};
+
+template <class HierORAM>
+PeriodicScheduler::Stats PeriodicScheduler::runPeriodic(HierORAM& oram) {
+    Stats s;
+    resetStats(s);
+    int64_t blocks = oram.getRealBlockCountOfDataORAM();
+    uint64_t budget = slot_service ? slot_service : oram.getWorstCaseLatency();
+    uint64_t cur_interval = rates.empty() ? interval : rates.back();
+    uint64_t epoch_start = 0, epoch_length = first_epoch;
+    size_t arrived = 0, epoch_first_arrival = 0;       // requests that reached the controller so far / at epoch start
+
+    uint64_t start = 0;
+    size_t next = 0;
+    while (next < requests.size()) {
+        uint64_t latency_before = oram.getHitLatency() + oram.getReadyLatency();
+        if (requests[next].arrival <= start && !oram.isLocalcacheFull()) {
+            const Request& r = requests[next++];
+            s.traffic += oram.access(((r.id % blocks) + blocks) % blocks, r.operation, r.id);
+            s.real_count++;
+            s.response_hist.record(start + (oram.getHitLatency() + oram.getReadyLatency() - latency_before) - r.arrival);
+        }
+        else {      // idle, or a background eviction step taking the slot
+            s.traffic += oram.dummyAccess();
+            s.dummy_count++;
+        }
+        uint64_t service = oram.getHitLatency() + oram.getReadyLatency() - latency_before;
+        uint64_t slot = budget + cur_interval;
+        s.makespan = start + max(service, budget);
+        if (service > budget) {
+            s.overrun_count++;
+            start += (service - budget + slot - 1) / slot * slot;
+        }
+        start += slot;
+
+        if (!rates.empty() && start >= epoch_start + epoch_length) {
+            while (arrived < requests.size() && requests[arrived].arrival <= start)
+                arrived++;
+            uint64_t chosen = chooseInterval(arrived - epoch_first_arrival, start - epoch_start, budget);
+            if (arrived > next)         // backlog left over, run at the fastest rate
+                chosen = rates.front();
+            if (chosen != cur_interval)
+                s.rate_changes++;
+            cur_interval = chosen;
+            epoch_length *= 2;
+            epoch_start = start;
+            epoch_first_arrival = arrived;
+        }
+    }
+    return s;
+}
+
+template <class HierORAM>
+PeriodicScheduler::Stats PeriodicScheduler::runOnDemand(HierORAM& oram) {
+    Stats s;
+    resetStats(s);
+    int64_t blocks = oram.getRealBlockCountOfDataORAM();
+    uint64_t now = 0;
+    for (size_t i = 0; i < requests.size(); i++) {
+        const Request& r = requests[i];
+        if (i + 1 < requests.size())
+            oram.prefetch(((requests[i + 1].id % blocks) + blocks) % blocks);
+        uint64_t start = max(now, r.arrival);
+        uint64_t latency_before = oram.getHitLatency() + oram.getReadyLatency();
+        int64_t dummy_before = oram.getDummyAccessCountOfDataORAM();
+        s.traffic += oram.access(((r.id % blocks) + blocks) % blocks, r.operation, r.id);
+        s.traffic += oram.backgroundEviction();
+        s.real_count++;
+        s.dummy_count += oram.getDummyAccessCountOfDataORAM() - dummy_before;
+        now = start + (oram.getHitLatency() + oram.getReadyLatency() - latency_before);
+        s.response_hist.record(now - r.arrival);
+    }
+    s.makespan = now;
+    return s;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <scoped_allocator>
+using namespace std;
+
+/*
+    Arena for the stash containers' nodes. Nodes are carved from large chunks
+    and recycled through one free list per node size, so once the arena has
+    been reserved for a full stash, inserting into and erasing from the stash
+    never reaches malloc. The arena grows by another chunk if the reserve was
+    too small and never returns memory before it is destroyed.
+
+    Only single-node allocations are pooled; arrays (hash buckets) go to the
+    heap, so maps sharing an arena should reserve() their bucket count up front.
+*/
+class NodeArena {
+private:
+    static const size_t align = alignof(max_align_t);
+    static const int max_classes = 8;
+
+    struct SizeClass {
+        size_t size;
+        void* free_list;
+    };
+
+    SizeClass classes[max_classes];
+    int class_count;
+    vector<char*> chunks;
+    char* cursor;
+    char* chunk_end;
+    size_t chunk_bytes;
+    size_t allocated_bytes;
+
+    static size_t roundUp(size_t size) { return (size + align - 1) & ~(align - 1); }
+
+    SizeClass& sizeClass(size_t size) {
+        for (int i = 0; i < class_count; i++)
+            if (classes[i].size == size)
+                return classes[i];
+        if (class_count == max_classes)
+            throw bad_alloc();
+        classes[class_count].size = size;
+        classes[class_count].free_list = NULL;
+        return classes[class_count++];
+    }
+
+    void grow(size_t bytes) {
+        char* chunk = (char*)malloc(bytes);
+        if (!chunk)
+            throw bad_alloc();
+        chunks.push_back(chunk);
+        cursor = chunk;
+        chunk_end = chunk + bytes;
+        allocated_bytes += bytes;
+    }
+
+public:
+    NodeArena() : class_count(0), cursor(NULL), chunk_end(NULL), chunk_bytes(64 * 1024), allocated_bytes(0) {}
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    ~NodeArena() {
+        for (char* chunk : chunks)
+            free(chunk);
+    }
+
+    // room for at least `bytes` more node memory without another chunk
+    void reserve(size_t bytes) {
+        bytes = roundUp(bytes);
+        if ((size_t)(chunk_end - cursor) < bytes)
+            grow(max(bytes, chunk_bytes));
+        chunk_bytes = max(chunk_bytes, bytes / 4);
+    }
+
+    void reserveNodes(size_t count, size_t node_bytes) { reserve(count * roundUp(node_bytes)); }
+
+    void* allocate(size_t size) {
+        SizeClass& c = sizeClass(roundUp(size));
+        if (c.free_list) {
+            void* p = c.free_list;
+            c.free_list = *(void**)p;
+            return p;
+        }
+        if ((size_t)(chunk_end - cursor) < c.size)
+            grow(chunk_bytes);
+        void* p = cursor;
+        cursor += c.size;
+        return p;
+    }
+
+    void deallocate(void* p, size_t size) {
+        SizeClass& c = sizeClass(roundUp(size));
+        *(void**)p = c.free_list;
+        c.free_list = p;
+    }
+
+    size_t getAllocatedBytes() { return allocated_bytes; }
+    size_t getChunkCount() { return chunks.size(); }
+};
+
+// STL allocator over a NodeArena; a default-constructed one uses the heap
+template <class T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    NodeArena* arena;
+
+    PoolAllocator() : arena(NULL) {}
+    explicit PoolAllocator(NodeArena* a) : arena(a) {}
+    template <class U> PoolAllocator(const PoolAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        if (arena && n == 1)
+            return (T*)arena->allocate(sizeof(T));
+        return (T*)::operator new(n * sizeof(T));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (arena && n == 1)
+            arena->deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+};
+
+template <class T, class U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) { return a.arena == b.arena; }
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) { return a.arena != b.arena; }
+
+// node sizes for reserveNodes(): a list node carries two links, a hash map node
+// a link and, for some key types, the cached hash
+template <class T> size_t listNodeBytes() { return sizeof(T) + 2 * sizeof(void*); }
+template <class K, class V> size_t mapNodeBytes() { return sizeof(pair<const K, V>) + 2 * sizeof(void*); }
+
+template <class T>
+using PoolList = list<T, PoolAllocator<T> >;
+
+// scoped, so containers stored as values (e.g. PoolList) draw from the same arena
+template <class K, class V>
+using PoolMap = unordered_map<K, V, hash<K>, equal_to<K>, scoped_allocator_adaptor<PoolAllocator<pair<const K, V> > > >;
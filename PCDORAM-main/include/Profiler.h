@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+using namespace std;
+
+/*
+    Hot-path instrumentation. Build with -DORAM_PROFILE=1 to enable; otherwise
+    ORAM_PROFILE_SCOPE expands to nothing and the engines carry no timing code.
+*/
+#ifndef ORAM_PROFILE
+#define ORAM_PROFILE 0
+#endif
+
+class Profiler {
+public:
+
+    enum Phase {
+        access = 0,
+        scan_stash,
+        read_path,
+        pick_blocks_to_evict,
+        write_path,
+        hybrid_block_merge,
+        hybrid_block_kick_out,
+        find_best_fit_path,
+        phase_count
+    };
+
+    // owned by one thread; others only read them when aggregating
+    struct Counters {
+        atomic<uint64_t> cycles[phase_count];
+        atomic<uint64_t> calls[phase_count];
+    };
+
+    static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static inline void add(Phase phase, uint64_t cycles) {
+        Counters& c = local();
+        c.cycles[phase].store(c.cycles[phase].load(memory_order_relaxed) + cycles, memory_order_relaxed);
+        c.calls[phase].store(c.calls[phase].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    static Counters& local();
+    static void aggregate(uint64_t* cycles, uint64_t* calls);
+    static void reset();
+    static void report(ostream& os);
+    static const char* phaseName(int phase);
+};
+
+class ScopedTimer {
+private:
+    Profiler::Phase phase;
+    uint64_t start;
+public:
+    ScopedTimer(Profiler::Phase p) : phase(p), start(Profiler::now()) { }
+    ~ScopedTimer() { Profiler::add(phase, Profiler::now() - start); }
+};
+
+#define ORAM_PROFILE_CONCAT2(a, b) a##b
+#define ORAM_PROFILE_CONCAT(a, b) ORAM_PROFILE_CONCAT2(a, b)
+
+#if ORAM_PROFILE
+#define ORAM_PROFILE_SCOPE(phase) ScopedTimer ORAM_PROFILE_CONCAT(oram_scoped_timer_, __LINE__)(Profiler::phase)
+#else
+#define ORAM_PROFILE_SCOPE(phase) do { } while (0)
+#endif
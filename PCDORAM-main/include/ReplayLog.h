@@ -0,0 +1,64 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+using namespace std;
+
+/*
+    Binary log of the random decisions taken during an ORAM run.
+    In record mode every traced value is appended to the file, in replay mode
+    the recorded value is returned instead of the freshly drawn one. Callers
+    pass the range a value must fall in for the engine as it is now; a recorded
+    value outside it (e.g. a log from a differently configured engine) ends
+    the replay like a missing record, and the fresh value is used from then on.
+    Each record is one tag byte followed by a LEB128 varint payload.
+*/
+class ReplayLog {
+public:
+
+    enum Mode {
+        off = 0,
+        record = 1,
+        replay = 2
+    };
+
+    enum Tag {
+        seed_tag = 1,       // engine seed
+        leaf_tag = 2,       // remapped leaf
+        evict_tag = 3,      // eviction / kick-out decision
+        block_tag = 4       // substituted block id
+    };
+
+private:
+    Mode mode;
+    fstream file;
+    int64_t record_count;
+    bool diverged;
+
+    void put(uint8_t tag, uint64_t value);
+    bool get(uint8_t tag, uint64_t& value);
+    uint64_t trace(uint8_t tag, uint64_t value, uint64_t lo, uint64_t hi);
+
+public:
+
+    ReplayLog();
+
+    bool open(const string& file_name, Mode m);
+    void close();
+
+    unsigned traceSeed(unsigned seed);
+    // lo, hi: the valid range, inclusive
+    int64_t traceLeaf(int64_t leaf, int64_t lo, int64_t hi);
+    int64_t traceEvict(int64_t choice, int64_t lo, int64_t hi);
+    int64_t traceBlock(int64_t id, int64_t lo, int64_t hi);
+
+    Mode getMode();
+    bool isRecording();
+    bool isReplaying();
+    bool isDiverged();
+    int64_t getRecordCount();
+
+    ~ReplayLog();
+};
@@ -2,7 +2,10 @@
 #define LOLLIRAM_STASH_H
 
 #include "LocalCacheLine.h"
-#include <list>
+#include "Histogram.h"
+#include "Oblivious.h"
+#include "StashArea.h"
+#include <vector>
 
 class Stash
 {
@@ -15,12 +18,21 @@ private:
     int block_size;
     float limit_factor;    
 public:
-    list<LocalCacheLine> local_cache;
-    list<LocalCacheLine>::iterator iter;
+    StashArea local_cache;		// reserved for a full stash by setMaxStashSize()
+    StashArea::iterator iter;
+
+    // oblivious mode: blocks live in entries instead of local_cache, the real ones
+    // packed at the front between accesses; the last Z * L + 1 entries receive a path
+    bool oblivious;
+    vector<ObliviousBlock> entries;
+    int entry_count;
+
+    Histogram occupancy_hist;		// occupancy after each access
 
     Stash();
 
     void updatePeakAndLastOccupancy();
+    void recordOccupancy();
     bool isFull(int margin = 0);
 
     bool isAlmostFull();
@@ -31,6 +43,7 @@ public:
     void setZvalue(int z);
     void setLvalue(int l);
     void setBlockSize(int bs);
+    void setOblivious(bool on);		// after setMaxStashSize()
 
     // getter func()
     int getMaxStashSize();
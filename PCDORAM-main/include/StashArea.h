@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "LocalCacheLine.h"
+#include "TreeLayout.h"
+using namespace std;
+
+/*
+    Stash blocks in one contiguous array in insertion order, so lookups and
+    eviction scan nothing but the 8-byte entries themselves. Eviction marks
+    the blocks it takes and drops them all in one compaction pass. Pointers
+    and iterators are invalidated by erase(), removeMarked() and by insert()
+    past the reserved size.
+*/
+class StashArea {
+    static_assert(sizeof(LocalCacheLine) == 8, "find() scans entries as pairs of 32-bit words");
+
+private:
+    vector<LocalCacheLine> lines;
+
+public:
+    typedef vector<LocalCacheLine>::iterator iterator;
+
+    void reserve(size_t n) { lines.reserve(n); }
+
+    size_t size() const { return lines.size(); }
+    bool empty() const { return lines.empty(); }
+    iterator begin() { return lines.begin(); }
+    iterator end() { return lines.end(); }
+    LocalCacheLine& operator[](size_t i) { return lines[i]; }
+
+    // NULL if the block is not here. Compares 8 entries per instruction with
+    // AVX-512 and 4 with AVX2, like scanBucket()
+    LocalCacheLine* find(int64_t id) {
+        int n = lines.size(), i = 0;
+        int32_t key = (int32_t)id;
+#if defined(__AVX512F__) || defined(__AVX2__)
+        const int32_t* words = (const int32_t*)lines.data();		// id, leaf, id, leaf, ...
+#endif
+#if defined(__AVX512F__)
+        const __m512i key16 = _mm512_set1_epi32(key);
+        for (; i + 8 <= n; i += 8) {
+            __mmask16 m = _mm512_mask_cmpeq_epi32_mask(0x5555, _mm512_loadu_si512((const void*)(words + 2 * i)), key16);
+            if (m)
+                return &lines[i + lowestBit(m) / 2];
+        }
+#endif
+#if defined(__AVX2__)
+        const __m256i key8 = _mm256_set1_epi32(key);
+        for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(words + 2 * i));
+            int m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, key8))) & 0x55;
+            if (m)
+                return &lines[i + lowestBit(m) / 2];
+        }
+#endif
+        for (; i < n; i++)
+            if (lines[i].id == key)
+                return &lines[i];
+        return NULL;
+    }
+
+    // the caller makes sure the block is not here yet
+    void insert(const LocalCacheLine& line) { lines.push_back(line); }
+
+    bool erase(int64_t id) {
+        LocalCacheLine* line = find(id);
+        if (!line)
+            return false;
+        lines.erase(lines.begin() + (line - lines.data()));
+        return true;
+    }
+
+    void mark(size_t i) { lines[i].id = -1; }
+
+    // drops the marked entries, keeping the others in order
+    void removeMarked() {
+        size_t kept = 0;
+        for (size_t i = 0; i < lines.size(); i++)
+            if (lines[i].id != -1)
+                lines[kept++] = lines[i];
+        lines.resize(kept);
+    }
+
+    void clear() { lines.clear(); }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+using namespace std;
+
+/*
+    Index arithmetic shared by the tree ORAM engines. Buckets are numbered in
+    heap order from the root (0); the leaf_count leaves are buckets
+    leaf_count - 1 .. 2 * leaf_count - 2, and level 0 is the root.
+*/
+// branch-free on GCC/clang, the oblivious stash relies on it
+inline int bitLength(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 64 - __builtin_clzll(x | 1) - (x == 0);
+#else
+    int n = 0;
+    while (x) {
+        n++;
+        x >>= 1;
+    }
+    return n;
+#endif
+}
+
+inline int popCount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x; x &= x - 1)
+        n++;
+    return n;
+#endif
+}
+
+// index of the lowest set bit, x != 0
+inline int lowestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        n++;
+        x >>= 1;
+    }
+    return n;
+#endif
+}
+
+// bitmap with the z slots of a bucket set, z <= 64
+inline uint64_t bucketMask(int z) {
+    return z == 64 ? ~0ull : (1ull << z) - 1;
+}
+
+// deepest level shared by the paths to leaf buckets a and b
+inline int deepestSharedLevel(int64_t leaf_a, int64_t leaf_b, int64_t leaf_count, int level_count) {
+    return level_count - 1 - bitLength((uint64_t)(leaf_a - (leaf_count - 1)) ^ (uint64_t)(leaf_b - (leaf_count - 1)));
+}
+
+// buckets on the path to leaf, root first: out[level] for level 0 .. level_count - 1
+inline void pathBuckets(int64_t leaf, int level_count, int64_t* out) {
+    for (int level = level_count - 1; level >= 0; level--) {
+        out[level] = leaf;
+        leaf = (leaf - 1) / 2;
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ORAM_PREFETCH(addr, rw) __builtin_prefetch((const void*)(addr), (rw))
+#else
+#define ORAM_PREFETCH(addr, rw) ((void)(addr))
+#endif
+
+/*
+    Requests every slot line of the z-slot buckets on a path up front, so the
+    level_count cache/TLB misses of the walk that follows overlap instead of
+    being taken one level at a time. RW: 0 before a read, 1 before a write.
+*/
+template <int RW>
+inline void prefetchPath(const int64_t* slots, const int64_t* buckets, int level_count, int z) {
+    for (int level = 0; level < level_count; level++) {
+        const int64_t* bucket = slots + buckets[level] * z;
+        for (int j = 0; j < z; j += 8)
+            ORAM_PREFETCH(bucket + j, RW);
+        ORAM_PREFETCH(bucket + z - 1, RW);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <random>
+#include <deque>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+/*
+    Synthetic request streams fed straight into access(), so large ORAMs can be
+    characterized without storing traces. Block ids are in [0, block_count).
+    Operations follow the configured read / write / write_back mix, using the
+    engines' Operations values. With write_backs in the mix, reads check their
+    block out of the ORAM (read | checkout) and a write_back hands back the
+    oldest checked-out block, so the ORAM never gets a block it still holds.
+*/
+class WorkloadGenerator {
+public:
+
+    enum Pattern {
+        uniform = 0,
+        zipfian = 1,        // Gray et al. generator, rank scrambled over the id space
+        sequential = 2,
+        strided = 3,
+        hot_cold = 4,       // hot_probability of the accesses go to hot_fraction of the blocks
+        phase_shift = 5     // hot/cold whose hot set moves every phase_length accesses
+    };
+
+    struct Request {
+        int64_t id;
+        short operation;
+    };
+
+private:
+    Pattern pattern;
+    int64_t block_count;
+    int64_t issued;
+    mt19937_64 rng;
+    uniform_real_distribution<double> unit;
+
+    // zipfian
+    double theta;
+    double zeta_n;
+    double zeta_2;
+    double alpha;
+    double eta;
+    bool scramble;
+
+    int64_t stride;
+    double hot_fraction;
+    double hot_probability;
+    int64_t phase_length;
+
+    // cumulative thresholds of the operation mix
+    double read_ratio;
+    double write_ratio;
+
+    deque<int64_t> checked_out;         // oldest first
+    vector<bool> is_checked_out;        // empty without write_backs in the mix
+
+    static double zeta(int64_t n, double theta);
+    void prepareZipfian();
+    int64_t nextId();
+    short nextOperation();
+
+public:
+    WorkloadGenerator(Pattern p, int64_t blocks, unsigned seed = 1234);
+
+    void setZipfSkew(double t);                 // 0 < t < 1, 0.99 as in YCSB by default
+    void setScramble(bool s);
+    void setStride(int64_t s);
+    void setHotCold(double fraction, double probability);
+    void setPhaseLength(int64_t n);
+    void setOperationMix(double read, double write, double write_back);     // weights, normalized
+
+    Pattern getPattern();
+    int64_t getBlockCount();
+    int64_t getIssuedCount();
+
+    Request next();
+
+    // issue `count` requests, each followed by the ORAM's background eviction; returns total traffic.
+    // The next request is generated one ahead so its path loads overlap the current access.
+    template <class ORAM>
+    uint64_t drive(ORAM& oram, int64_t count) {
+        uint64_t traffic = 0;
+        Request ahead = { -1, 0 };
+        if (count > 0)
+            ahead = next();
+        for (int64_t i = 0; i < count; i++) {
+            Request r = ahead;
+            if (i + 1 < count) {
+                ahead = next();
+                oram.prefetch(ahead.id);
+            }
+            traffic += oram.access(r.id, r.operation, r.id);
+            traffic += oram.backgroundEviction();
+        }
+        return traffic;
+    }
+
+    static const char* patternName(Pattern p);
+    static bool parsePattern(const string& name, Pattern& p);
+};